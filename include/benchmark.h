@@ -0,0 +1,47 @@
+#pragma once
+#include <vector>
+#include <chrono>
+#include <string>
+#include <cstdio>
+#include <GLEW/glew.h>
+#include "renderstats.h"
+#include "gldispatch.h"
+
+//frames a GPU timestamp query pair stays in flight before we read it back
+#define BENCHMARK_QUERY_FRAMES 4
+
+//what one benchmark frame cost
+struct FrameSample {
+    double cpuMs;       //wall time from beginFrame to endFrame, swap included
+    double gpuMs;       //between the GPU timestamps at the same points, -1 until it's read back
+    unsigned drawCalls;
+    unsigned programBinds;
+    //from the GL_STATS dispatch layer, zero without it
+    uint64_t glCalls, glRedundant, glBytes;
+};
+
+//records per-frame timings for --benchmark and writes the report. GPU time comes from
+//GL_TIMESTAMP queries on a small ring so reading them never stalls the frame that's being drawn
+//(timestamps rather than GL_TIME_ELAPSED, which can't nest with other timer queries)
+class Benchmark {
+    private:
+        std::vector<FrameSample> samples;
+        GLuint queries[BENCHMARK_QUERY_FRAMES][2];
+        long pending[BENCHMARK_QUERY_FRAMES];   //sample index waiting in each slot, -1 if none
+        std::chrono::steady_clock::time_point frameStart;
+        FILE *out;                              //the real stdout once claimStdout has moved the logs off it
+        void collect(int slot);
+    public:
+        Benchmark();
+        void init();
+        void beginFrame();
+        //gl is glDispatchLastFrame(), so call glDispatchEndFrame first
+        void endFrame(const RenderStats &stats, const GLDispatchStats &gl);
+        //reads back whatever GPU timings are still in flight
+        void finish();
+        //for a report on stdout: call before anything is printed, the logs then go to stderr
+        void claimStdout();
+        //JSON summary, or one CSV row per frame if the filename ends in .csv; NULL or "-" is stdout
+        bool write(const char *filename, const std::string &renderer, int width, int height, const char *clock);
+        size_t frames() const { return samples.size(); }
+};
@@ -21,5 +21,6 @@ class Camera {
         void initKeyboard();
         void processInput(float dt);
         void updateViewMat();
+        void setPose(glm::vec3 position, glm::vec2 rotation);
 };
 
@@ -0,0 +1,23 @@
+#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+
+//one point of a camera path: where, and which way (yaw, pitch in degrees like Camera::rotation)
+struct CameraKey {
+    glm::vec3 position;
+    glm::vec2 rotation;
+};
+
+//a smooth camera path for benchmark runs: a Catmull-Rom spline through a list of keys
+class CameraPath {
+    private:
+        std::vector<CameraKey> keys;
+    public:
+        //one key per line: x y z yaw pitch, # starts a comment. Prints why and returns false on failure
+        bool load(const char *filename);
+        //built in walk along the wall of paintings and round to the dome
+        void gallery();
+        //u goes from 0 (first key) to 1 (last key)
+        CameraKey sample(float u) const;
+        size_t size() const { return keys.size(); }
+};
@@ -2,10 +2,23 @@
 #define WINDOW_HEIGHT 900
 #define WINDOW_NAME "Generative Art Gallery"
 
+//frames rendered by --headless when --frames isn't given
+#define HEADLESS_DEFAULT_FRAMES 300
+//frames of camera path flown by --benchmark
+#define BENCHMARK_DEFAULT_FRAMES 600
+
+//half the side of the quad every painting is drawn on
+#define PAINTING_SIZE 15.f
+
 //these are set inside the shaders themselves
 #define VERTEX_POSITION_LOC 0
 #define COLOR_LOC 1
 #define UV_LOC 2
 #define NORMAL_LOC 3
+//per-instance attributes of INSTANCED vertex shaders: a mat4 takes 4 locations (4-7)
+#define INSTANCE_MODEL_LOC 4
+#define INSTANCE_PARAMS_LOC 8
 
-#define TIME_LOC 2
+//uniform buffer binding point of the FrameGlobals block, see shaders/frameglobals.glsl
+#define FRAME_GLOBALS_BINDING 0
+#define FRAME_GLOBALS_GLSL "shaders/frameglobals.glsl"
@@ -0,0 +1,28 @@
+#pragma once
+#include "simd.h"
+
+class ThreadPool;
+
+/**
+ * C++ versions of painting fragment shaders, for rendering without a GPU (--poster with --cpu)
+ * and as the reference the GLSL is checked against (--compare). Each shades SIMD_WIDTH pixels
+ * per call, one lane per pixel. The ones in cpushaders.cpp are written by hand and follow their
+ * shaders/NAME.frag.glsl line for line, so a change to one has to be made to the other: --compare
+ * is there to catch the ones that weren't. Every other painting gets a version translated from its
+ * GLSL at build time by tools/glsl2cpp, which registers itself with registerCpuShader.
+ */
+//fraguv in, rgb out (the paintings all have alpha 1)
+typedef void (*CpuShader)(floatv u, floatv v, float time, floatv &r, floatv &g, floatv &b);
+
+//the version of fragshader (shaders/NAME.frag.glsl), NULL if it doesn't have one yet
+CpuShader cpuShader(const char *fragshader);
+//adds the version of shaders/NAME.frag.glsl, called by the generated code as the program starts.
+//A hand written one of the same name is used over it
+void registerCpuShader(const char *name, CpuShader shader);
+
+//the w x h pixels at x0, y0 of the painting at width x height into rgba (stride bytes a row), top
+//row first with fraguv 0,0 at the top left as the quad in the gallery has it. Spread over pool in
+//CPU_TILE sized tiles
+#define CPU_TILE 64
+void cpuShade(ThreadPool &pool, CpuShader shader, float time, int width, int height,
+              int x0, int y0, int w, int h, unsigned char *rgba, int stride);
@@ -0,0 +1,71 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstdio>
+#include <GLEW/glew.h>
+
+//frames read back asynchronously: glReadPixels into this many pixel buffer objects in turn,
+//each one mapped only when it comes round again, by which time the GPU has long finished with it
+#define EXPORT_PBO_COUNT 3
+//frames waiting for the writer thread before capture() blocks on it
+#define EXPORT_QUEUE_FRAMES 8
+
+//writes what gets rendered to image files or a video stream, for --export.
+//The main thread only starts readbacks and copies finished ones out, encoding and file I/O
+//happen on a writer thread, so the frame rate stays whatever the GPU can do
+class Exporter {
+    public:
+        enum Format { PNG, PPM, Y4M, RAW };
+    private:
+        struct Slot {
+            GLuint pbo;
+            GLsync fence;
+            long frame;         //-1 while empty
+        };
+        struct Frame {
+            long index;
+            std::vector<unsigned char> pixels;  //RGBA, bottom row first as GL reads them
+        };
+        Format format;
+        std::string path;       //printf pattern for PNG/PPM, one file (or - for stdout) for Y4M/RAW
+        int width, height, fps;
+        FILE *stream;
+        Slot slots[EXPORT_PBO_COUNT];
+        long firstFrame;        //index of the first capture, for file names
+        long captured, written;
+        double gpuWait, writerWait;     //seconds capture() spent blocked, on each side
+        std::atomic<bool> failed;   //set by the writer, the frames after it aren't written
+
+        std::thread writer;
+        std::mutex queueMutex;
+        std::condition_variable queueCond;
+        std::deque<Frame> queue;
+        std::vector<std::vector<unsigned char>> spare;  //recycled pixel buffers
+        bool finishing;
+
+        void collect(Slot &s);
+        void writerLoop();
+        bool writeFrame(const Frame &f, std::vector<unsigned char> &scratch);
+    public:
+        Exporter();
+        //format is png, ppm, y4m or raw, NULL to go by the extension of path ("-" is stdout, raw by default).
+        //Numbered files count from firstFrame. Prints why and returns false if it can't
+        bool open(const char *path, const char *format, int width, int height, int fps, long firstFrame);
+        //the printf pattern numbered frames exported to file are written under
+        static std::string framePattern(const std::string &file);
+        //for exporting to "-": call before anything is printed, so none of it ends up in the stream
+        void claimStdout();
+        bool active() const { return !path.empty(); }
+        //a frame failed to write, rendering any more of them is wasted
+        bool failing() const { return failed; }
+        //reads back the frame just drawn from the bound read framebuffer, call once per frame
+        void capture();
+        //collects the readbacks still in flight, waits for the writer and closes the output.
+        //False unless every frame captured got written
+        bool finish();
+};
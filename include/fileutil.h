@@ -0,0 +1,6 @@
+#pragma once
+
+#include <string>
+
+// mkdir -p, for the program and mesh caches. No GL in here, tools/meshconv links it
+bool make_dirs(const std::string& path);
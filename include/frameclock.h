@@ -0,0 +1,35 @@
+#pragma once
+#include <vector>
+#include <chrono>
+
+//the one place time comes from: sampled once per frame with tick(), everything drawn in that
+//frame sees the same time() and dt(). Besides the wall clock it can step by an exact amount every
+//frame or play back a list of times, so two runs render the same frames
+class FrameClock {
+    public:
+        enum Mode { WALL, FIXED, SCRIPT };
+    private:
+        Mode clockMode;
+        double step;                    //FIXED
+        std::vector<double> script;     //SCRIPT, one time per frame
+        double now, delta;
+        long frameIndex;
+        std::chrono::steady_clock::time_point started;
+
+        double timeAt(long frame) const;    //FIXED and SCRIPT
+    public:
+        FrameClock();
+        //"wall", "fixed" (1/60 s), "fixed:STEP" or "script:FILE", prints why and returns false if it can't
+        bool configure(const char *spec);
+        //moves on to the next frame
+        void tick();
+        //the next tick() is frame, with the time and dt it would have had counting up from 0
+        //(a shard of a longer render, see shards.h)
+        void seek(long frame);
+        double time() const { return now; }
+        double dt() const { return delta; }
+        long frame() const { return frameIndex; }
+        Mode mode() const { return clockMode; }
+        //real seconds since the clock was made, whatever the mode (for fps and reports)
+        double wall() const;
+};
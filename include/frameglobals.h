@@ -0,0 +1,33 @@
+#pragma once
+#include <GLEW/glew.h>
+#include <glm/glm.hpp>
+#include "camera.h"
+
+// C++ mirror of the FrameGlobals uniform block in shaders/frameglobals.glsl, std140 layout:
+// mat4s are 64 bytes each, the scalars pack after them and the block is padded to 16 bytes
+struct FrameGlobals {
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::mat4 viewProjection;
+    float time;
+    float dt;
+    glm::vec2 resolution;
+    GLint frame;
+    GLint pad[3];
+};
+static_assert(sizeof(FrameGlobals) == 224, "FrameGlobals must match the std140 layout of the shader block");
+
+// owns the uniform buffer behind the FrameGlobals block, bound once to FRAME_GLOBALS_BINDING
+class FrameUniforms {
+    private:
+        GLuint ubo;
+        FrameGlobals data;
+    public:
+        FrameUniforms();
+        void init();
+        //call once per frame, after the camera has been updated. frame is the clock's, so a shard
+        //worker uploads the same value as a single process would at that frame
+        void update(const Camera &cam, float time, float dt, glm::vec2 resolution, long frame);
+        const FrameGlobals &current() const { return data; }
+        GLuint buffer() const { return ubo; }
+};
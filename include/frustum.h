@@ -0,0 +1,18 @@
+#pragma once
+#include <glm/glm.hpp>
+
+struct BoundingSphere {
+    glm::vec3 center;
+    float radius;
+};
+
+//the six planes of a view frustum, pulled out of a projection * view matrix
+class Frustum {
+    private:
+        glm::vec4 planes[6];    //xyz normal pointing inwards, w distance
+    public:
+        Frustum();
+        void extract(const glm::mat4 &viewProjection);
+        //conservative: spheres near a corner may pass even if just outside
+        bool intersects(const BoundingSphere &s) const;
+};
@@ -1,20 +1,44 @@
+#pragma once
 #include "shader_util.h"
+#include <string>
+#include <memory>
 #include <glm/glm.hpp>
 #include "globals.h"
+#include "frustum.h"
+#include "meshregistry.h"
 
 class Geometry {
     private:
         shader_prog pshader;
+        shader_prog depthshader;        //our vertex shader with depth.frag, for the depth prepass
+        shader_prog instanceshader;     //both again with INSTANCED, for GeometryBatch
+        shader_prog instanceDepthshader;
+        std::shared_ptr<GpuMesh> mesh;  //shared with every Geometry of the same file (see meshregistry.h)
         glm::vec3 position;
         float angle;
-        GLuint VAO, numFaces;
         float scale;
-        const glm::mat4 &projectionMatrix;
-        const glm::mat4 &viewMatrix;
+        uniform_handle modelLoc, depthModelLoc;
+        bool uniformsResolved, depthResolved;
+        bool quantized;                 //vertices in the QuantizedVertex layout (meshfile.h)
     public:
-        Geometry(const char *objfile, const char *vshader, const char *fshader);
+        std::string name;   //the mesh file, for profiling and logs
+
+        //quantized: upload the compact vertex layout, the vertex shader gets QUANTIZED defined to decode it
+        Geometry(const char *objfile, const char *vshader, const char *fshader, bool quantized = false);
         void importMesh(const char *objfile);
+        bool ready();
+        bool instanceable();
         void render();
+        void renderDepth();
+        //count instances whose model matrices (instanceMatrix()) are in instanceVBO from start on, drawn with our mesh and shaders
+        void renderInstanced(GLuint instanceVBO, size_t start, GLsizei count);
+        void renderDepthInstanced(GLuint instanceVBO, size_t start, GLsizei count);
+        GLuint instancedProgram();
+        const GpuMesh *gpuMesh() const { return mesh.get(); }
+        glm::mat4 modelMatrix() const;
+        //modelMatrix with the quantization decode folded in, what the vertex shader needs
+        glm::mat4 instanceMatrix() const;
+        BoundingSphere bounds() const;
         void setScale(float scale);
         void setAngle(float angle);
         void setPos(glm::vec3 position);
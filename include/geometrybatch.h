@@ -0,0 +1,39 @@
+#pragma once
+#include <vector>
+#include "geometry.h"
+
+//collects Geometry each frame and draws every group sharing a mesh and a program with a single
+//glDrawElementsInstanced, so a room full of the same pedestal is one draw call.
+//Groups are drawn separately so a RenderQueue can order them by depth
+class GeometryBatch {
+    private:
+        struct Queued {
+            Geometry *geometry;
+            float depth;
+        };
+        struct Group {
+            Geometry *first;    //whose mesh and shaders draw the group
+            GLuint program;
+            size_t start, count;
+            float depth;        //of the nearest instance
+        };
+        GLuint instanceVBO;
+        size_t capacity;
+        std::vector<Queued> queued;
+        std::vector<glm::mat4> instances;
+        std::vector<Group> groups;
+    public:
+        GeometryBatch();
+        void init();
+        void clear();
+        void add(Geometry *g);
+        //groups what was added, front to back inside each group, and uploads the instances
+        void build(const glm::mat4 &view);
+        void drawGroup(size_t i);
+        void drawGroupDepth(size_t i);
+        size_t groupCount() const { return groups.size(); }
+        float groupDepth(size_t i) const { return groups[i].depth; }
+        GLuint groupProgram(size_t i) const { return groups[i].program; }
+        size_t groupSize(size_t i) const { return groups[i].count; }
+        const char *groupName(size_t i) const { return groups[i].first->name.c_str(); }
+};
@@ -0,0 +1,123 @@
+#pragma once
+#include <GLEW/glew.h>
+#include <cstdio>
+#include <cstdint>
+
+//GL call counting for perf work. With GL_STATS defined (make GLSTATS=1, which force-includes this
+//header into every file) the GL calls the renderer makes per frame are redirected to the gld*
+//wrappers below: they count calls per kind, calls that didn't change anything (binding what's
+//already bound, enabling what's enabled, setting a uniform to its current value) and bytes uploaded,
+//then call through to GL. Only calls from the main context are meant to go through here.
+//Without GL_STATS nothing is redirected and the counters stay at zero
+
+enum GLDispatchKind {
+    GLD_PROGRAM,        //glUseProgram
+    GLD_VERTEX_ARRAY,   //glBindVertexArray
+    GLD_BUFFER,         //glBindBuffer, glBindBufferBase
+    GLD_TEXTURE,        //glActiveTexture, glBindTexture
+    GLD_FRAMEBUFFER,    //glBindFramebuffer
+    GLD_CAPABILITY,     //glEnable, glDisable
+    GLD_FIXED_STATE,    //glDepthFunc, glColorMask, glCullFace, glViewport
+    GLD_UNIFORM,        //glUniform*
+    GLD_ATTRIBUTE,      //glVertexAttrib4fv, glVertexAttribPointer
+    GLD_UPLOAD,         //glBufferData, glBufferSubData, glTexImage2D
+    GLD_DRAW,           //glDraw*
+    GLD_CLEAR,          //glClear
+    GLD_KIND_COUNT
+};
+
+struct GLDispatchStats {
+    uint64_t calls[GLD_KIND_COUNT];
+    uint64_t redundant[GLD_KIND_COUNT];
+    uint64_t bytes;     //uploaded through buffers, textures and uniforms
+
+    uint64_t totalCalls() const;
+    uint64_t totalRedundant() const;
+};
+
+const char *glDispatchKindName(int kind);
+//true if built with GL_STATS, so the numbers mean something
+bool glDispatchEnabled();
+//call once at the end of a frame: what was counted becomes lastFrame() and is added to the totals
+void glDispatchEndFrame();
+const GLDispatchStats &glDispatchLastFrame();
+//per frame averages over every finished frame
+void glDispatchPrintAverages(FILE *out);
+//forget everything known about bound state, for after something changed GL behind our back
+void glDispatchInvalidate();
+
+//the wrappers, same signatures as GL
+void GLAPIENTRY gldUseProgram(GLuint program);
+void GLAPIENTRY gldBindVertexArray(GLuint array);
+void GLAPIENTRY gldBindBuffer(GLenum target, GLuint buffer);
+void GLAPIENTRY gldBindBufferBase(GLenum target, GLuint index, GLuint buffer);
+void GLAPIENTRY gldActiveTexture(GLenum texture);
+void GLAPIENTRY gldBindTexture(GLenum target, GLuint texture);
+void GLAPIENTRY gldBindFramebuffer(GLenum target, GLuint framebuffer);
+void GLAPIENTRY gldEnable(GLenum cap);
+void GLAPIENTRY gldDisable(GLenum cap);
+void GLAPIENTRY gldDepthFunc(GLenum func);
+void GLAPIENTRY gldColorMask(GLboolean r, GLboolean g, GLboolean b, GLboolean a);
+void GLAPIENTRY gldCullFace(GLenum mode);
+void GLAPIENTRY gldViewport(GLint x, GLint y, GLsizei width, GLsizei height);
+void GLAPIENTRY gldUniform1i(GLint location, GLint v0);
+void GLAPIENTRY gldUniform1f(GLint location, GLfloat v0);
+void GLAPIENTRY gldUniform3f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2);
+void GLAPIENTRY gldUniform4f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3);
+void GLAPIENTRY gldUniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat *value);
+void GLAPIENTRY gldVertexAttrib4fv(GLuint index, const GLfloat *v);
+void GLAPIENTRY gldVertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const GLvoid *pointer);
+void GLAPIENTRY gldBufferData(GLenum target, GLsizeiptr size, const GLvoid *data, GLenum usage);
+void GLAPIENTRY gldBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const GLvoid *data);
+void GLAPIENTRY gldTexImage2D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const GLvoid *pixels);
+void GLAPIENTRY gldDrawElements(GLenum mode, GLsizei count, GLenum type, const GLvoid *indices);
+void GLAPIENTRY gldDrawElementsInstanced(GLenum mode, GLsizei count, GLenum type, const GLvoid *indices, GLsizei primcount);
+void GLAPIENTRY gldDrawArrays(GLenum mode, GLint first, GLsizei count);
+void GLAPIENTRY gldClear(GLbitfield mask);
+
+#ifdef GL_STATS
+//the list is repeated in gldispatch.cpp, which undoes it to reach the real functions
+#undef glUseProgram
+#define glUseProgram gldUseProgram
+#undef glBindVertexArray
+#define glBindVertexArray gldBindVertexArray
+#undef glBindBuffer
+#define glBindBuffer gldBindBuffer
+#undef glBindBufferBase
+#define glBindBufferBase gldBindBufferBase
+#undef glActiveTexture
+#define glActiveTexture gldActiveTexture
+#define glBindTexture gldBindTexture
+#undef glBindFramebuffer
+#define glBindFramebuffer gldBindFramebuffer
+#define glEnable gldEnable
+#define glDisable gldDisable
+#define glDepthFunc gldDepthFunc
+#define glColorMask gldColorMask
+#define glCullFace gldCullFace
+#define glViewport gldViewport
+#undef glUniform1i
+#define glUniform1i gldUniform1i
+#undef glUniform1f
+#define glUniform1f gldUniform1f
+#undef glUniform3f
+#define glUniform3f gldUniform3f
+#undef glUniform4f
+#define glUniform4f gldUniform4f
+#undef glUniformMatrix4fv
+#define glUniformMatrix4fv gldUniformMatrix4fv
+#undef glVertexAttrib4fv
+#define glVertexAttrib4fv gldVertexAttrib4fv
+#undef glVertexAttribPointer
+#define glVertexAttribPointer gldVertexAttribPointer
+#undef glBufferData
+#define glBufferData gldBufferData
+#undef glBufferSubData
+#define glBufferSubData gldBufferSubData
+#define glTexImage2D gldTexImage2D
+#define glDrawElements gldDrawElements
+#undef glDrawElementsInstanced
+#define glDrawElementsInstanced gldDrawElementsInstanced
+#define glDrawArrays gldDrawArrays
+#define glClear gldClear
+#endif
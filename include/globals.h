@@ -3,4 +3,8 @@
 
 //globals which need to be visible from multiple files
 extern Camera cam;
+extern bool cachePaintings; //toggled with C, see PaintingCache
+extern bool depthPrepass;   //toggled with P, see RenderQueue
+extern bool gpuProfile;     //toggled with G, times every draw and shows the GpuProfiler overlay
+extern bool dumpGpuProfile; //set with L, main prints the GPU cost leaderboard and clears it
 
@@ -0,0 +1,38 @@
+#pragma once
+#include <vector>
+#include <GLEW/glew.h>
+
+//texture units and uniform buffer bindings GLState keeps track of, higher ones go straight to GL
+#define GLSTATE_TEXTURE_UNITS 8
+#define GLSTATE_UNIFORM_BINDINGS 8
+
+//what we last told GL, so render code can just say what it needs for each draw and only actual
+//changes reach the driver: nothing unbinds after itself any more (shader_prog::end doesn't),
+//every draw sets the program, VAO and cull/depth state it relies on.
+//Everything on the main context has to go through here, or the cache goes stale (see invalidate)
+class GLState {
+    private:
+        struct Cap {
+            GLenum cap;
+            int on;             //-1 unknown
+        };
+        GLint curProgram, curVao, activeUnit, curDepthFunc, curDepthMask, curColorMask;
+        GLint textures[GLSTATE_TEXTURE_UNITS];
+        GLint uniformBuffers[GLSTATE_UNIFORM_BINDINGS];
+        std::vector<Cap> caps;
+    public:
+        GLState();
+        void useProgram(GLuint program);
+        void bindVertexArray(GLuint vao);
+        void enable(GLenum cap, bool on);
+        void depthFunc(GLenum func);
+        void depthMask(bool write);
+        void colorMask(bool write);
+        //2D textures, unit counts from 0
+        void bindTexture(int unit, GLuint texture);
+        void bindUniformBuffer(GLuint index, GLuint buffer);
+        //forget everything, for when GL state was changed some other way
+        void invalidate();
+};
+
+extern GLState glState;
@@ -0,0 +1,68 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <map>
+#include <cstdio>
+#include <GLEW/glew.h>
+#include <glm/glm.hpp>
+#include "shader_util.h"
+
+//frames of queries in flight: results are read GPU_PROFILER_FRAMES frames later, when they're done
+#define GPU_PROFILER_FRAMES 3
+//samples per section the rolling statistics are taken over
+#define GPU_PROFILER_HISTORY 120
+
+//rolling GPU cost of one labelled section (a painting, the dome, the depth prepass...)
+struct GpuSection {
+    std::string label;
+    double history[GPU_PROFILER_HISTORY];   //ms per frame, summed if it ran more than once
+    int samples;                            //how many of history are filled
+    int next;
+    glm::vec3 color;                        //its bar in the overlay
+
+    double mean() const;
+    double max() const;
+    double last() const;
+};
+
+//GL_TIME_ELAPSED queries around labelled sections of the frame. Each frame uses its own set of
+//query objects and reads back the set from GPU_PROFILER_FRAMES frames ago, so the CPU never waits
+//on the GPU; a set that still isn't done by then is dropped instead.
+//Timer queries can't nest, so sections can't either
+class GpuProfiler {
+    private:
+        struct Pending {
+            int section;
+            GLuint query;
+        };
+        std::vector<GpuSection> sections;
+        std::map<std::string, int> ids;
+        std::vector<GLuint> pool[GPU_PROFILER_FRAMES];
+        std::vector<Pending> pending[GPU_PROFILER_FRAMES];
+        long frameIndex;
+        int open;           //section being timed, -1 if none
+        long dropped;       //frames whose results weren't ready in time
+        shader_prog overlayshader;
+        GLuint overlayVAO, overlayVBO;
+        void collect(int slot);
+    public:
+        bool enabled;
+
+        GpuProfiler();
+        void init();
+        void beginFrame();
+        void begin(const char *label);
+        void end();
+        //leaderboard, most expensive first
+        void dump(FILE *out) const;
+        //bar chart of the leaderboard in the top left corner, in the same order as dump()
+        void drawOverlay();
+        const std::vector<GpuSection> &all() const { return sections; }
+};
+
+//begin/end for a block scope, does nothing if profiler is NULL or disabled
+struct GpuZone {
+    GpuProfiler *profiler;
+    GpuZone(GpuProfiler *p, const char *label) : profiler(p && p->enabled ? p : NULL) { if (profiler) profiler->begin(label); }
+    ~GpuZone() { if (profiler) profiler->end(); }
+};
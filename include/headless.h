@@ -0,0 +1,32 @@
+#pragma once
+#include <GLEW/glew.h>
+
+//what the GLX build of GLEW 2 returns from glewInit on a context without an X display, after it has
+//loaded the GL functions. The bundled glew.h is older than that code
+#ifndef GLEW_ERROR_NO_GLX_DISPLAY
+#define GLEW_ERROR_NO_GLX_DISPLAY 4
+#endif
+
+//GL context without a display, for render nodes and CI: EGL on Mesa's surfaceless platform
+//(so llvmpipe works with no GPU at all), drawing into a framebuffer object of our own size
+//instead of a window. Everything else renders exactly as it does on screen
+class HeadlessContext {
+    private:
+        void *display, *context;    //EGLDisplay, EGLContext; EGL headers stay out of here
+        GLuint fbo, colorRB, depthRB;
+        int width, height;
+    public:
+        typedef void (*Proc)();
+
+        HeadlessContext();
+        //creates the context and makes it current, prints why if it can't
+        bool init();
+        //needs GL functions, so call it after glewInit
+        bool createFramebuffer(int width, int height);
+        //our framebuffer and viewport, the headless equivalent of the window
+        void bind();
+        void destroy();
+        GLuint framebuffer() const { return fbo; }
+        //a GL function GLEW doesn't know about, looked up with eglGetProcAddress. NULL if there's none
+        static Proc procAddress(const char *name);
+};
@@ -0,0 +1,81 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "frustum.h"
+
+/**
+ * Binary mesh cache, so assimp only ever parses a mesh once.
+ * A file is a MeshHeader followed by the interleaved vertex blob (MESH_VERTEX_FLOATS floats per
+ * vertex, the layout Geometry uploads) and the 32 bit index blob. The header records the size and
+ * modification time of the source file, a changed .obj just misses the cache and is re-imported.
+ * Entries are written on first import, or ahead of time with tools/meshconv (make meshes).
+ */
+#define MESH_CACHE_DIR "cache/meshes"
+//2: triangles and vertices reordered by meshOptimize
+#define MESH_FORMAT_VERSION 2
+//vx, vy, vz, u, v, nx, ny, nz
+#define MESH_VERTEX_FLOATS 8
+
+struct MeshHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t vertexFloats;
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint32_t reserved;
+    uint64_t sourceSize;
+    int64_t sourceTime;
+    float center[3];
+    float radius;
+    uint64_t vertexOffset;      //from the start of the file
+    uint64_t indexOffset;
+};
+
+//a mesh as it comes out of assimp, before it is written or uploaded
+struct MeshData {
+    std::vector<float> vertices;
+    std::vector<uint32_t> indices;
+    BoundingSphere bounds;
+};
+
+//the compact vertex layout Geometry can upload instead, 16 bytes instead of 32:
+//position as unorm16 inside the mesh's box (the 4th is padding), uv as half floats,
+//normal octahedral encoded in two snorm16 (decoded in dome.vert.glsl)
+struct QuantizedVertex {
+    uint16_t position[4];
+    uint16_t uv[2];
+    int16_t normal[2];
+};
+
+//first mesh of the file, triangulated, identical vertices joined, reordered for the GPU (see meshopt.h)
+bool meshImport(const char *objfile, MeshData &out);
+//where the cache entry for objfile lives
+std::string meshCachePath(const char *objfile);
+//writes to a temporary and renames, so readers never see half a file
+bool meshWrite(const std::string &path, const char *objfile, const MeshData &mesh);
+
+//count vertices of the MESH_VERTEX_FLOATS layout into out, offset + scale * position gives back mesh space
+void meshQuantize(const float *vertices, uint32_t count, std::vector<QuantizedVertex> &out, glm::vec3 &offset, glm::vec3 &scale);
+
+//read-only view of a cache entry, mapped into memory so the blobs go straight to glBufferData
+class MeshFile {
+    private:
+        void *base;
+        size_t size;
+        const MeshHeader *header;
+    public:
+        MeshFile();
+        ~MeshFile();
+        MeshFile(const MeshFile&) = delete;
+        MeshFile& operator=(const MeshFile&) = delete;
+        //false if the entry is missing, truncated, from another format version, older than objfile
+        //or has an index past its vertices
+        bool open(const std::string &path, const char *objfile);
+        void close();
+        uint32_t vertexCount() const;
+        uint32_t indexCount() const;
+        const float *vertices() const;
+        const uint32_t *indices() const;
+        BoundingSphere bounds() const;
+};
@@ -0,0 +1,33 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+
+/**
+ * Import time reordering of triangle lists, run by meshImport before a mesh goes into the cache.
+ * None of it changes what ends up on screen, only the order the GPU gets things in:
+ * triangles for the post-transform vertex cache (Forsyth's linear-speed algorithm), then clusters
+ * of them so outward facing parts draw first and occlude the rest, then vertices in the order the
+ * index buffer first uses them so fetches walk memory forwards.
+ * Vertices are interleaved floats with the position first, stride given in floats.
+ */
+
+//cache the ordering optimizes for, bigger than any real one, it only has to be monotonic
+#define MESHOPT_CACHE_SIZE 32
+//FIFO cache the statistics simulate, about what current hardware has
+#define MESHOPT_FIFO_SIZE 16
+//how much worse (as a ratio) than the cache optimized order a cluster may make ACMR when splitting for overdraw
+#define MESHOPT_OVERDRAW_THRESHOLD 1.05f
+
+struct MeshCacheStats {
+    float acmr;     //transformed vertices per triangle, 0.5 is the ideal for a big regular grid, 3 the worst
+    float atvr;     //transformed vertices per vertex, 1 is ideal
+};
+
+MeshCacheStats meshAnalyzeVertexCache(const std::vector<uint32_t> &indices, uint32_t vertexCount, int cacheSize = MESHOPT_FIFO_SIZE);
+void meshOptimizeVertexCache(std::vector<uint32_t> &indices, uint32_t vertexCount);
+//expects indices already in vertex cache order, keeps most of it
+void meshOptimizeOverdraw(std::vector<uint32_t> &indices, const std::vector<float> &vertices, int stride, float threshold = MESHOPT_OVERDRAW_THRESHOLD);
+//also drops vertices no triangle uses
+void meshOptimizeVertexFetch(std::vector<float> &vertices, std::vector<uint32_t> &indices, int stride);
+//all three in order, printing ACMR/ATVR before and after
+void meshOptimize(std::vector<float> &vertices, std::vector<uint32_t> &indices, int stride);
@@ -0,0 +1,32 @@
+#pragma once
+#include <string>
+#include <memory>
+#include <GLEW/glew.h>
+#include <glm/glm.hpp>
+#include "frustum.h"
+
+/**
+ * Meshes on the GPU, shared: every Geometry made from the same file with the same vertex layout
+ * gets the same GpuMesh, so ten domes import and upload the mesh once. A mesh lives as long as some
+ * Geometry holds it, the GL objects go with the last reference.
+ */
+
+struct GpuMesh {
+    GLuint VAO = 0, vertexBuffer = 0, indexBuffer = 0;
+    GLuint numIndices = 0;
+    GLenum indexType = GL_UNSIGNED_INT;     //16 bit whenever the vertex count allows
+    bool quantized = false;                 //vertices in the QuantizedVertex layout (meshfile.h)
+    glm::mat4 decodeMatrix = glm::mat4(1.f);//quantized positions back to mesh space, identity otherwise
+    BoundingSphere bounds;                  //around the mesh as imported, before any model matrix
+    std::string name;                       //the mesh file
+    bool instanceAttributes = false;        //INSTANCE_MODEL_LOC.. enabled on the VAO yet
+
+    ~GpuMesh();
+    //points the per-instance model matrices at buffer, from instance start on (the VAO must be bound)
+    void pointInstances(GLuint buffer, size_t start);
+};
+
+//existing mesh for this file and layout, or a newly imported one
+//(from the binary mesh cache when it's up to date, through assimp otherwise)
+std::shared_ptr<GpuMesh> registryMesh(const std::string &objfile, bool quantized);
+void registryMeshStats(size_t &meshes);
@@ -0,0 +1,37 @@
+#pragma once
+
+//command line switches, see parseOptions for the list
+struct Options {
+    bool headless;      //no window: EGL context rendering into an offscreen framebuffer
+    int width, height;  //of the headless framebuffer
+    long frames;        //stop after this many frames, 0 runs until the window is closed
+    const char *clock;  //FrameClock::configure spec
+    bool benchmark;     //fly the camera along a path and report frame times
+    const char *path;   //CameraPath file for the benchmark, NULL for the built in one
+    const char *report; //where the benchmark report goes, NULL for stdout
+    bool gpuProfile;    //start with the GpuProfiler on, its leaderboard is printed at exit
+    const char *trace;  //Chrome trace of the PROFILE_ZONEs written here at exit, NULL for none
+    bool quantize;      //upload meshes in the compact QuantizedVertex layout
+    const char *exportPath;     //frames written here (see Exporter), NULL when not exporting
+    const char *exportFormat;   //png, ppm, y4m or raw, NULL to go by the extension
+    int fps;            //of the export, also its fixed clock step
+    const char *posterShader;   //fragment shader of the painting to render as a poster, NULL for none
+    const char *posterPath;     //.tif/.tiff or .ppm it goes to
+    int posterWidth, posterHeight;
+    int posterTile;     //tile edge, rounded down to what renderPoster can use
+    float posterTime;   //time the painting is frozen at
+    bool cpu;           //the poster from the C++ version of the painting, without GL
+    int threads;        //for the CPU shaders, 0 is one per core
+    const char *compareShader;  //painting to render on both GL and the CPU and compare, NULL for none
+    int tolerance;      //of 255, how far apart --compare lets a pixel be
+    double maxOutliers; //fraction of the pixels --compare lets be further apart than tolerance
+    long frameStart, frameEnd;  //of the frames, the ones this process renders (a shard worker), end 0 for all
+    int shards;         //worker processes to split the export over (see shards.h), 0 renders it here
+    long shardFrames;   //frames per shard, 0 picks
+    int shardThreads;   //llvmpipe threads per worker, 0 shares the cores out between them
+
+    Options();
+};
+
+//fills opts from argv, prints the usage and returns false on anything it doesn't understand
+bool parseOptions(int argc, char *argv[], Options &opts);
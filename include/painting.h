@@ -1,26 +1,61 @@
 #pragma once
 
 #include "shader_util.h"
+#include <string>
 #include <glm/glm.hpp>
 #include "globals.h"
+#include "frustum.h"
 
 class Painting {
 
     public:
         shader_prog pshader;
+        std::string name;   //for profiling and logs
         glm::vec3 position;
         float angle;
-        const glm::mat4 &projectionMatrix;
-        const glm::mat4 &viewMatrix;
+        glm::vec4 params;   //free per-painting values, paintingParams in INSTANCED shaders
+        uniform_handle modelLoc;
+        bool uniformsResolved;
 
-        Painting(shader_prog pshader) :
+        //drawn instead of a painting whose program is still compiling, set up in main
+        static shader_prog *placeholder;
+        static uniform_handle placeholderModelLoc;
+        //basic.vert with depth.frag, for the depth prepass of non-instanced paintings, set up in main
+        static shader_prog *depthshader;
+        static uniform_handle depthModelLoc;
+
+        Painting(shader_prog pshader, std::string name) :
                     pshader(pshader),
+                    name(name),
                     position(glm::vec3(0)),
                     angle(0.f),
-                    projectionMatrix(cam.projection),
-                    viewMatrix(cam.view)
+                    params(glm::vec4(0)),
+                    uniformsResolved(false)
                     {};
 
+        //looks up the per-object uniforms once so render() doesn't have to
+        //(view, projection and time are shared by everyone through the FrameGlobals block)
+        //override it if your painting has uniforms of its own
+        virtual void resolveUniforms() {
+            modelLoc = pshader.handle("modelMatrix");
+        }
+
+        //true once pshader has finished compiling (it's only submitted in the constructor)
+        bool ready() {
+            if (!uniformsResolved && pshader.poll()) {
+                resolveUniforms();
+                uniformsResolved = true;
+            }
+            return uniformsResolved;
+        }
+
+        //true if pshader is built with INSTANCED, so main can draw it through a PaintingBatch
+        virtual bool instanceable() const { return false; }
+
+        glm::mat4 modelMatrix() const;
+        BoundingSphere bounds() const;
+        void renderPlaceholder(GLuint VAO);
+        void renderDepth(GLuint VAO);
         virtual void render(GLuint VAO) =0;
-        ~Painting() {};
+        virtual ~Painting() {};
 };
@@ -0,0 +1,49 @@
+#pragma once
+#include <vector>
+#include "painting.h"
+
+//what the instance buffer holds per painting, matches the INSTANCED inputs of basic.vert.glsl
+struct PaintingInstance {
+    glm::mat4 model;
+    glm::vec4 params;
+};
+
+//collects instanceable paintings each frame and draws every group sharing a program with
+//a single glDrawElementsInstanced, instead of one bind + upload + draw per painting.
+//Groups are drawn separately so a RenderQueue can order them by depth
+class PaintingBatch {
+    private:
+        struct Queued {
+            Painting *painting;
+            float depth;
+        };
+        struct Group {
+            Painting *first;    //whose pshader we bind for the group
+            GLuint program;
+            size_t start, count;
+            float depth;        //of the nearest instance
+        };
+        GLuint VAO, instanceVBO;
+        size_t capacity;
+        shader_prog depthshader;    //INSTANCED basic.vert with depth.frag, for the depth prepass
+        std::vector<Queued> queued;
+        std::vector<PaintingInstance> instances;
+        std::vector<Group> groups;
+        void pointInstanceAttributes(size_t start);
+    public:
+        PaintingBatch();
+        //builds a VAO that reads the quad's vertex/index buffers plus our instance buffer
+        void init(GLuint quadVAO);
+        void clear();
+        void add(Painting *p);
+        //groups what was added, front to back inside each group, and uploads the instances
+        void build(const glm::mat4 &view);
+        void drawGroup(size_t i);
+        void drawGroupDepth(size_t i);
+        void draw();        //build() must have run, draws every group in program order
+        size_t groupCount() const { return groups.size(); }
+        float groupDepth(size_t i) const { return groups[i].depth; }
+        GLuint groupProgram(size_t i) const { return groups[i].program; }
+        //named after its first painting: groups are per program, which is normally one painting
+        const char *groupName(size_t i) const { return groups[i].first->name.c_str(); }
+};
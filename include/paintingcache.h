@@ -0,0 +1,38 @@
+#pragma once
+#include <vector>
+#include "painting.h"
+#include "frameglobals.h"
+
+//cached mode for paintings: each one renders into its own texture, sized after how big it is on screen,
+//and the gallery quad just samples that texture. Refreshes are spread over frames within a pixel budget,
+//most stale and largest visible paintings first, so the cost of the shaders on the walls stays capped
+class PaintingCache {
+    private:
+        struct Entry {
+            Painting *painting;
+            GLuint fbo, tex;
+            int size;           //texture is size x size, 0 until first allocated
+            int wanted;         //size picked from the on-screen footprint this frame, 0 if off screen
+            int age;            //frames since the last refresh
+            bool valid;         //has been rendered at least once at the current size
+        };
+        std::vector<Entry> entries;
+        shader_prog cachedshader;
+        uniform_handle modelLoc;
+        GLuint captureUBO;
+        void resize(Entry &e, int size);
+        void refresh(Entry &e, GLuint VAO, const FrameGlobals &frame);
+        int screenSize(const Painting &p, const FrameGlobals &frame, glm::ivec2 viewport) const;
+    public:
+        long pixelBudget;       //texels re-rendered per frame (at least one painting always gets refreshed)
+        int minSize, maxSize;
+
+        PaintingCache();
+        void init();
+        void add(Painting *p);
+        //picks texture sizes and refreshes what the budget allows; leaves the default framebuffer,
+        //viewport and FrameGlobals binding as they were
+        void update(GLuint VAO, const FrameUniforms &frame, glm::ivec2 viewport);
+        //draws every painting as a textured quad (placeholders for the ones still compiling)
+        void draw(GLuint VAO, const Frustum &frustum);
+};
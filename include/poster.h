@@ -0,0 +1,30 @@
+#pragma once
+#include <GLEW/glew.h>
+
+//--poster: one painting at print resolution, far past what a framebuffer can hold
+#define POSTER_DEFAULT_SIZE 16384
+#define POSTER_DEFAULT_TILE 2048
+//--compare passes while at most --max-outliers of the pixels are further off than --tolerance and
+//at most COMPARE_MAX_OVER_CAP are further off than COMPARE_HARD_CAP. Paintings that hash with
+//fract(sin(x) * big) or divide by something near zero blow last bit differences up into whole
+//pixels: on llvmpipe up to 1.7% of rainy's are over 2 and 0.17% over 32 (by up to 111), joydivision
+//has 0.6% over 2 and none past 17. A port that's wrong is off by a lot in far more places. GLSL leaves
+//sin undefined outside [-pi, pi]: llvmpipe's gives up somewhere past 1e7 (canvas gets there at some
+//times), the CPU versions stay exact, so those frames don't compare
+#define COMPARE_DEFAULT_MAX_OUTLIERS 0.02
+#define COMPARE_DEFAULT_TOLERANCE 2
+#define COMPARE_HARD_CAP 32
+#define COMPARE_MAX_OVER_CAP 0.005
+
+//renders the painting fshader (on basic.vert.glsl with TILED) tile by tile into outfile, a tiled
+//TIFF (.tif/.tiff, BigTIFF past 4GB) or a .ppm. Tiles go to disk as they finish, the image is never
+//in memory as a whole, and each tile is its own small submission so no single draw runs long enough
+//to trip a driver watchdog. FrameGlobals must already hold the time and resolution to render with.
+//Prints why and returns false if it can't
+bool renderPoster(const char *fshader, const char *outfile, int width, int height, int tile, GLuint quadVAO);
+//the same from the C++ version of the painting (cpushaders.h), no GL needed. threads as ThreadPool takes them
+bool renderCpuPoster(const char *fshader, const char *outfile, int width, int height, int tile, float time, int threads);
+//renders fshader at width x height on GL and on the CPU, prints how far apart they are, false if they
+//don't match (see COMPARE_HARD_CAP). FrameGlobals must hold time and the size, as for renderPoster
+bool comparePainting(const char *fshader, int width, int height, float time, int tolerance, double maxOutliers,
+                     int threads, GLuint quadVAO);
@@ -0,0 +1,40 @@
+#pragma once
+
+//CPU timing zones, compiled in only with GENART_PROFILE (make PROFILE=1):
+//    PROFILE_ZONE("drawWorld");
+//times the rest of the enclosing block. Each thread records into its own ring buffer, written
+//by that thread alone and never locked; profileWriteTrace saves the lot as Chrome trace_event
+//JSON (open it in chrome://tracing or Perfetto). Without GENART_PROFILE all of it compiles to nothing
+
+#ifdef GENART_PROFILE
+
+#include <cstdint>
+
+//events kept per thread, older ones get overwritten
+#define PROFILE_RING_SIZE 65536
+
+class ProfileZone {
+    private:
+        const char *name;   //must outlive the trace: string literals or long-lived names
+        int64_t start;
+    public:
+        explicit ProfileZone(const char *name);
+        ~ProfileZone();
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_ZONE(name) ProfileZone PROFILE_CONCAT(profileZone, __LINE__)(name)
+
+//name shown for the calling thread in the trace
+void profileThreadName(const char *name);
+bool profileWriteTrace(const char *filename);
+
+#else
+
+#define PROFILE_ZONE(name) ((void)0)
+
+inline void profileThreadName(const char *) {}
+inline bool profileWriteTrace(const char *) { return false; }
+
+#endif
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <string>
+#include <GLEW/glew.h>
+
+/**
+ * On-disk cache of linked program binaries (glGetProgramBinary/glProgramBinary).
+ * Entries are keyed by a hash of the final shader sources (FrameGlobals preamble and any
+ * injected lines included) plus the GL vendor/renderer/version strings, so editing a shader
+ * or updating the driver just misses the cache and falls back to compiling from source.
+ */
+#define PROGRAM_CACHE_DIR "cache/shaders"
+
+// 64 bit FNV-1a, also used by the shader registry to tell stage sources apart
+unsigned long long source_hash(const std::string& data, unsigned long long hash = 14695981039346656037ULL);
+
+bool program_cache_available();
+std::string program_cache_key(const std::string& v_source, const std::string& f_source);
+// true if prog is now linked from the cached binary; stale/rejected entries get deleted
+bool program_cache_load(GLuint prog, const std::string& key);
+// call before glLinkProgram for programs that should end up in the cache
+void program_cache_prepare(GLuint prog);
+void program_cache_store(GLuint prog, const std::string& key);
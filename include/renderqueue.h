@@ -0,0 +1,31 @@
+#pragma once
+#include <vector>
+#include <functional>
+#include <GLEW/glew.h>
+#include <glm/glm.hpp>
+#include "gpuprofiler.h"
+
+struct RenderItem {
+    const char *label;                  //GpuProfiler section, must outlive the frame
+    float depth;                        //view space distance, nearest first
+    GLuint program;                     //breaks ties so equal depths keep their binds together
+    std::function<void()> draw;
+    std::function<void()> drawDepth;    //depth-only version for the prepass, may be empty
+};
+
+//opaque draws of a frame, sorted front to back so the depth test rejects as much overdraw as possible.
+//With a depth prepass everything is first drawn depth-only with a trivial fragment shader, then shaded
+//with GL_LEQUAL, so every pixel runs at most one expensive painting shader
+class RenderQueue {
+    private:
+        std::vector<RenderItem> items;
+    public:
+        void clear();
+        void add(const char *label, float depth, GLuint program, std::function<void()> draw, std::function<void()> drawDepth = nullptr);
+        //with a profiler every item is timed under its label, the prepass as a whole as "depth prepass"
+        void render(bool depthPrepass, GpuProfiler *profiler = NULL);
+        size_t size() const { return items.size(); }
+};
+
+//distance along the view direction of a world space point
+float viewDepth(const glm::mat4 &view, const glm::vec3 &point);
@@ -0,0 +1,13 @@
+#pragma once
+
+//per-frame counters, reset at the start of every frame in main
+struct RenderStats {
+    unsigned drawn;     //objects that passed frustum culling
+    unsigned culled;    //objects skipped by it
+    unsigned drawCalls; //glDraw* calls issued
+    unsigned programBinds;  //programs actually bound through glState.useProgram, redundant begin()s not counted
+
+    void reset() { *this = RenderStats(); }
+};
+
+extern RenderStats renderStats;
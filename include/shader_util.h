@@ -1,27 +1,65 @@
 #pragma once
 
 #include <string>
+#include <vector>
+#include <memory>
+#include <functional>
 #include <GLEW/glew.h>
 #include "glm/glm.hpp"
 #include "glm/gtc/matrix_transform.hpp"
 #include <glm/gtc/type_ptr.hpp>
 
+// one entry per active uniform, filled once after linking (see shader_prog::reflect)
+struct uniform_info {
+    std::string name;
+    GLenum type;
+    GLint size;         // array length, 1 for plain uniforms
+    GLint location;     // -1 for uniforms that live inside a uniform block
+    GLint block;        // uniform block index, -1 for the default block
+};
+
+// pre-resolved uniform location: look it up once with shader_prog::handle() after setup,
+// then pass it to the typed setters so the per-frame path never touches strings
+struct uniform_handle {
+    GLint loc = -1;
+};
+
+struct program_state; // see shaderregistry.h
+
 /**
  * Modified version of code from:
  *  http://stackoverflow.com/questions/2795044/easy-framework-for-opengl-shaders-in-c-c
  */
 class shader_prog {
 private:
-    GLuint vertex_shader, fragment_shader, prog;
-    std::string v_source, f_source;
+    std::string v_source, f_source;        // dropped once submitted
+    std::shared_ptr<program_state> state;  // shared with every shader_prog using the same sources
+    void reflect();
+    void finish();
 public:
-    shader_prog(const char* vertex_shader_filename, const char* fragment_shader_filename);
-    void setup();
+    // how submit() compiles, chosen once at startup (see shaderloader.h):
+    // with parallel_compile the driver compiles on its own threads and poll() asks GL_COMPLETION_STATUS_KHR,
+    // otherwise if background is set the compile+link job is handed to it (a thread with a shared context)
+    static bool parallel_compile;
+    static std::function<void(std::function<void()>)> background;
+
+    // defines: extra lines pasted into both stages after #version, e.g. "#define INSTANCED"
+    shader_prog(const char* vertex_shader_filename, const char* fragment_shader_filename, const char* defines = NULL);
+    void setup();           // submit() and wait for it
+    void submit();          // start compiling/linking without waiting
+    bool poll();            // true once linked and usable, never blocks on the compile itself
+    bool is_ready() const;
     void free();
     void begin();
     void end();
     operator GLuint();
 
+    // Uniform reflection
+    const std::vector<uniform_info>& active_uniforms() const;
+    const uniform_info* find_uniform(const char* name) const;
+    uniform_handle handle(const char* name) const;      // throws if the uniform isn't active
+    uniform_handle try_handle(const char* name) const;  // loc -1 (silently ignored by GL) if it isn't
+
     // Shorthands for glUniform specification
     void uniform1i(const char* name, int i);
     void uniform1f(const char* name, float f);
@@ -29,6 +67,12 @@ public:
     void uniformMatrix4fv(const char* name, const float* matrix);
     void uniformMatrix4fv(const char* name, glm::mat4 matrix);
     void attribute3fv(const char* name, GLfloat* vecArray, int numberOfVertices);
-};
 
+    // Same, but with a pre-resolved handle
+    void uniform1i(uniform_handle h, int i);
+    void uniform1f(uniform_handle h, float f);
+    void uniform3f(uniform_handle h, float x, float y, float z);
+    void uniform4f(uniform_handle h, float x, float y, float z, float w);
+    void uniformMatrix4fv(uniform_handle h, const glm::mat4& matrix);
+};
 
@@ -0,0 +1,9 @@
+#pragma once
+#include <GLEW/glew.h>
+#include <GLFW/glfw3.h>
+
+// sets up background shader compilation for shader_prog::submit(), call once after glewInit:
+// uses GL_KHR_parallel_shader_compile when the driver has it, otherwise starts a loader thread
+// on a hidden window sharing win's context. With win == NULL only the extension is tried
+void startShaderLoader(GLFWwindow *win);
+void stopShaderLoader();
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <string>
+#include <memory>
+#include <atomic>
+#include <vector>
+#include "shader_util.h"
+
+/**
+ * Central registry behind shader_prog: shader stages are keyed by a hash of their final source and
+ * compiled once no matter how many programs use them, and programs are keyed by their stage pair so
+ * paintings with identical shaders share a single linked GL program (and its uniform table).
+ */
+
+// one compiled shader object
+struct shader_stage {
+    GLuint shader;
+    GLenum type;
+    bool checked;       // compile status has been verified
+};
+
+// one GL program, shared by every shader_prog built from the same vertex/fragment pair
+struct program_state {
+    GLuint prog = 0;
+    std::shared_ptr<shader_stage> vertex, fragment;    // only set while the program still has to be finished
+    std::string cache_key;
+    std::vector<uniform_info> uniforms;                 // sorted by name
+    enum { idle, compiling, ready, failed } status = idle;
+    std::shared_ptr<std::atomic<bool>> background_done; // set while the loader thread owns the link
+};
+
+// existing stage for this source, or a fresh (not yet compiled) shader object with created = true
+std::shared_ptr<shader_stage> registry_stage(GLenum type, const std::string& source, bool& created);
+// existing program for this source pair, or a fresh idle one with created = true
+std::shared_ptr<program_state> registry_program(const std::string& v_source, const std::string& f_source, bool& created);
+void registry_stats(size_t& stages, size_t& programs);
@@ -0,0 +1,21 @@
+#pragma once
+#include "options.h"
+
+//frames per worker process the shard size aims for when --shard-frames isn't given: small enough
+//that the workers finish together and a crash loses little, big enough to amortize startup
+#define SHARDS_PER_WORKER 4
+
+/**
+ * --shards N: one long --export spread over N worker processes on this machine.
+ * The frames are cut into shards, and each is handed to a fresh copy of this program with
+ * --frame-range. Every worker has its own headless context. The fixed clock and the camera path
+ * make its frames identical to those of a single process render: time, dt and the frame uniform
+ * all come from the clock, which the worker seeks to its first frame. Numbered images are written by
+ * the workers under their final names. y4m and raw go to a part file per shard, which are joined
+ * in order once all are done. Finished shards are logged in <export>.shards, so running the same
+ * command again after a crash only renders what's missing.
+ * llvmpipe spreads every context over threads of its own: --shard-threads (LP_NUM_THREADS) sets
+ * how many each worker gets, and the fps at the end is what to compare processes x threads by.
+ */
+//runs the whole export as the coordinator, prints why and returns false if any shard failed
+bool runShards(int argc, char *argv[], const Options &opts);
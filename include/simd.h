@@ -0,0 +1,203 @@
+#pragma once
+#include <cmath>
+
+/**
+ * A float per SIMD lane, for shading several pixels at once on the CPU (see cpushaders.h).
+ * 8 lanes with AVX (make AVX=1), 4 with SSE2 (any x86-64), 4 plain floats anywhere else.
+ * Only the handful of primitives below differ per instruction set, the GLSL built-ins the
+ * painting shaders use are written once on top of them. Comparisons give masks for select(),
+ * which is how branches in a shader turn into straight-line code.
+ * (glm's gtx/simd_vec4 is SSE only, a 4 component vector rather than 4 pixels, and has no sin.)
+ */
+#if defined(__AVX__)
+#include <immintrin.h>
+#define SIMD_WIDTH 8
+
+struct floatv {
+    __m256 v;
+    floatv() {}
+    floatv(__m256 x) : v(x) {}
+    floatv(float x) : v(_mm256_set1_ps(x)) {}
+    static floatv load(const float *p) { return _mm256_loadu_ps(p); }
+    void store(float *p) const { _mm256_storeu_ps(p, v); }
+};
+inline floatv operator+(floatv a, floatv b) { return _mm256_add_ps(a.v, b.v); }
+inline floatv operator-(floatv a, floatv b) { return _mm256_sub_ps(a.v, b.v); }
+inline floatv operator*(floatv a, floatv b) { return _mm256_mul_ps(a.v, b.v); }
+inline floatv operator/(floatv a, floatv b) { return _mm256_div_ps(a.v, b.v); }
+inline floatv min(floatv a, floatv b) { return _mm256_min_ps(a.v, b.v); }
+inline floatv max(floatv a, floatv b) { return _mm256_max_ps(a.v, b.v); }
+inline floatv sqrt(floatv a) { return _mm256_sqrt_ps(a.v); }
+inline floatv floor(floatv a) { return _mm256_floor_ps(a.v); }
+inline floatv abs(floatv a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.f), a.v); }
+inline floatv operator<(floatv a, floatv b) { return _mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ); }
+inline floatv operator>(floatv a, floatv b) { return _mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ); }
+inline floatv operator==(floatv a, floatv b) { return _mm256_cmp_ps(a.v, b.v, _CMP_EQ_OQ); }
+inline floatv operator<=(floatv a, floatv b) { return _mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ); }
+inline floatv operator>=(floatv a, floatv b) { return _mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ); }
+inline floatv operator!=(floatv a, floatv b) { return _mm256_cmp_ps(a.v, b.v, _CMP_NEQ_UQ); }
+//masks combined: both, either, a but not b
+inline floatv operator&(floatv a, floatv b) { return _mm256_and_ps(a.v, b.v); }
+inline floatv operator|(floatv a, floatv b) { return _mm256_or_ps(a.v, b.v); }
+inline floatv andNot(floatv a, floatv b) { return _mm256_andnot_ps(b.v, a.v); }
+//mask ? a : b, lane by lane
+inline floatv select(floatv mask, floatv a, floatv b) { return _mm256_blendv_ps(b.v, a.v, mask.v); }
+inline bool any(floatv mask) { return _mm256_movemask_ps(mask.v) != 0; }
+
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define SIMD_WIDTH 4
+
+struct floatv {
+    __m128 v;
+    floatv() {}
+    floatv(__m128 x) : v(x) {}
+    floatv(float x) : v(_mm_set1_ps(x)) {}
+    static floatv load(const float *p) { return _mm_loadu_ps(p); }
+    void store(float *p) const { _mm_storeu_ps(p, v); }
+};
+inline floatv operator+(floatv a, floatv b) { return _mm_add_ps(a.v, b.v); }
+inline floatv operator-(floatv a, floatv b) { return _mm_sub_ps(a.v, b.v); }
+inline floatv operator*(floatv a, floatv b) { return _mm_mul_ps(a.v, b.v); }
+inline floatv operator/(floatv a, floatv b) { return _mm_div_ps(a.v, b.v); }
+inline floatv min(floatv a, floatv b) { return _mm_min_ps(a.v, b.v); }
+inline floatv max(floatv a, floatv b) { return _mm_max_ps(a.v, b.v); }
+inline floatv sqrt(floatv a) { return _mm_sqrt_ps(a.v); }
+inline floatv abs(floatv a) { return _mm_andnot_ps(_mm_set1_ps(-0.f), a.v); }
+inline floatv operator<(floatv a, floatv b) { return _mm_cmplt_ps(a.v, b.v); }
+inline floatv operator>(floatv a, floatv b) { return _mm_cmpgt_ps(a.v, b.v); }
+inline floatv operator==(floatv a, floatv b) { return _mm_cmpeq_ps(a.v, b.v); }
+inline floatv operator<=(floatv a, floatv b) { return _mm_cmple_ps(a.v, b.v); }
+inline floatv operator>=(floatv a, floatv b) { return _mm_cmpge_ps(a.v, b.v); }
+inline floatv operator!=(floatv a, floatv b) { return _mm_cmpneq_ps(a.v, b.v); }
+inline floatv operator&(floatv a, floatv b) { return _mm_and_ps(a.v, b.v); }
+inline floatv operator|(floatv a, floatv b) { return _mm_or_ps(a.v, b.v); }
+inline floatv andNot(floatv a, floatv b) { return _mm_andnot_ps(b.v, a.v); }
+inline floatv select(floatv mask, floatv a, floatv b) {
+    return _mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v));
+}
+inline bool any(floatv mask) { return _mm_movemask_ps(mask.v) != 0; }
+//no round instruction before SSE4.1: truncate, step down where that went up, and leave
+//anything past 2^23 alone, it has no fraction left (and wouldn't fit the int)
+inline floatv floor(floatv a) {
+    __m128 t = _mm_cvtepi32_ps(_mm_cvttps_epi32(a.v));
+    t = _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, a.v), _mm_set1_ps(1.f)));
+    return select(abs(a) < floatv(8388608.f), floatv(t), a);
+}
+
+#else
+#define SIMD_WIDTH 4
+
+struct floatv {
+    float v[4];
+    floatv() {}
+    floatv(float x) { for (int i = 0; i < 4; i++) v[i] = x; }
+    static floatv load(const float *p) { floatv r; for (int i = 0; i < 4; i++) r.v[i] = p[i]; return r; }
+    void store(float *p) const { for (int i = 0; i < 4; i++) p[i] = v[i]; }
+};
+#define SIMD_LANEWISE(expr) floatv r; for (int i = 0; i < 4; i++) r.v[i] = (expr); return r;
+//masks are all bits set as in SSE, here read back as "not zero"
+inline float simdMask(bool b) { return b ? -1.f : 0.f; }
+inline floatv operator+(floatv a, floatv b) { SIMD_LANEWISE(a.v[i] + b.v[i]) }
+inline floatv operator-(floatv a, floatv b) { SIMD_LANEWISE(a.v[i] - b.v[i]) }
+inline floatv operator*(floatv a, floatv b) { SIMD_LANEWISE(a.v[i] * b.v[i]) }
+inline floatv operator/(floatv a, floatv b) { SIMD_LANEWISE(a.v[i] / b.v[i]) }
+inline floatv min(floatv a, floatv b) { SIMD_LANEWISE(b.v[i] < a.v[i] ? b.v[i] : a.v[i]) }
+inline floatv max(floatv a, floatv b) { SIMD_LANEWISE(b.v[i] > a.v[i] ? b.v[i] : a.v[i]) }
+inline floatv sqrt(floatv a) { SIMD_LANEWISE(std::sqrt(a.v[i])) }
+inline floatv floor(floatv a) { SIMD_LANEWISE(std::floor(a.v[i])) }
+inline floatv abs(floatv a) { SIMD_LANEWISE(std::fabs(a.v[i])) }
+inline floatv operator<(floatv a, floatv b) { SIMD_LANEWISE(simdMask(a.v[i] < b.v[i])) }
+inline floatv operator>(floatv a, floatv b) { SIMD_LANEWISE(simdMask(a.v[i] > b.v[i])) }
+inline floatv operator==(floatv a, floatv b) { SIMD_LANEWISE(simdMask(a.v[i] == b.v[i])) }
+inline floatv operator<=(floatv a, floatv b) { SIMD_LANEWISE(simdMask(a.v[i] <= b.v[i])) }
+inline floatv operator>=(floatv a, floatv b) { SIMD_LANEWISE(simdMask(a.v[i] >= b.v[i])) }
+inline floatv operator!=(floatv a, floatv b) { SIMD_LANEWISE(simdMask(a.v[i] != b.v[i])) }
+inline floatv operator&(floatv a, floatv b) { SIMD_LANEWISE(simdMask(a.v[i] != 0.f && b.v[i] != 0.f)) }
+inline floatv operator|(floatv a, floatv b) { SIMD_LANEWISE(simdMask(a.v[i] != 0.f || b.v[i] != 0.f)) }
+inline floatv andNot(floatv a, floatv b) { SIMD_LANEWISE(simdMask(a.v[i] != 0.f && b.v[i] == 0.f)) }
+inline floatv select(floatv mask, floatv a, floatv b) { SIMD_LANEWISE(mask.v[i] != 0.f ? a.v[i] : b.v[i]) }
+inline bool any(floatv mask) { return mask.v[0] != 0.f || mask.v[1] != 0.f || mask.v[2] != 0.f || mask.v[3] != 0.f; }
+#undef SIMD_LANEWISE
+#endif
+
+//every lane set, and a mask flipped
+inline floatv simdTrue() { return floatv(0.f) == floatv(0.f); }
+inline floatv maskNot(floatv mask) { return andNot(simdTrue(), mask); }
+
+//the GLSL built-ins, same names and meaning
+inline floatv operator-(floatv a) { return floatv(0.f) - a; }
+inline floatv ceil(floatv a) { return -floor(-a); }
+inline floatv sign(floatv a) { return select(a > 0.f, floatv(1.f), select(a < 0.f, floatv(-1.f), floatv(0.f))); }
+inline floatv step(floatv edge, floatv x) { return select(x < edge, floatv(0.f), floatv(1.f)); }
+inline floatv inversesqrt(floatv a) { return floatv(1.f) / sqrt(a); }
+inline floatv radians(floatv a) { return a * floatv(0.0174532925199432957692f); }
+inline floatv degrees(floatv a) { return a * floatv(57.2957795130823208768f); }
+inline floatv fract(floatv a) { return a - floor(a); }
+inline floatv mod(floatv a, floatv b) { return a - b * floor(a / b); }
+inline floatv clamp(floatv a, floatv lo, floatv hi) { return min(max(a, lo), hi); }
+inline floatv mix(floatv a, floatv b, floatv t) { return a + (b - a) * t; }
+inline floatv smoothstep(floatv e0, floatv e1, floatv x) {
+    floatv t = clamp((x - e0) / (e1 - e0), 0.f, 1.f);
+    return t * t * (floatv(3.f) - floatv(2.f) * t);
+}
+
+//sin and cos bring the argument down to [-pi/2, pi/2] around a multiple m of pi/2 in four steps
+//(Cody-Waite), good to a few ulp up to SIMD_SIN_RANGE. The fract(sin(x * big)) hashes of the
+//paintings go past that now and then, those lanes are done one at a time in double, a hash is
+//only worth anything if it's exact
+#define SIMD_SIN_RANGE 39000.f
+inline floatv simdReduce(floatv x, floatv m) {
+    floatv r = x - m * floatv(3.140625f);
+    r = r - m * floatv(0.0009670257568359375f);
+    r = r - m * floatv(6.2771141529083251953e-07f);
+    return r - m * floatv(1.2154201256553420762e-10f);
+}
+//sin(r) for r in [-pi/2, pi/2]
+inline floatv simdSinPoly(floatv r) {
+    floatv s = r * r;
+    floatv u = floatv(2.6083159809786593541503e-06f);
+    u = u * s + floatv(-0.0001981069071916863322258f);
+    u = u * s + floatv(0.00833307858556509017944336f);
+    u = u * s + floatv(-0.166666597127914428710938f);
+    return s * u * r + r;
+}
+inline floatv simdLanewise(floatv x, double (*f)(double)) {
+    float lanes[SIMD_WIDTH];
+    x.store(lanes);
+    for (int i = 0; i < SIMD_WIDTH; i++) lanes[i] = (float)f((double)lanes[i]);
+    return floatv::load(lanes);
+}
+inline floatv simdLanewise(floatv x, floatv y, double (*f)(double, double)) {
+    float lanes[SIMD_WIDTH], second[SIMD_WIDTH];
+    x.store(lanes);
+    y.store(second);
+    for (int i = 0; i < SIMD_WIDTH; i++) lanes[i] = (float)f((double)lanes[i], (double)second[i]);
+    return floatv::load(lanes);
+}
+inline floatv sin(floatv x) {
+    if (any(abs(x) > floatv(SIMD_SIN_RANGE))) return simdLanewise(x, std::sin);
+    floatv n = floor(x * floatv(0.318309886183790671538f) + floatv(0.5f));
+    floatv u = simdSinPoly(simdReduce(x, n));
+    //x = r + n pi: odd n flips the sign
+    return select(mod(n, 2.f) == floatv(1.f), -u, u);
+}
+inline floatv cos(floatv x) {
+    if (any(abs(x) > floatv(SIMD_SIN_RANGE))) return simdLanewise(x, std::cos);
+    floatv n = floor(x * floatv(0.318309886183790671538f));
+    floatv u = simdSinPoly(simdReduce(x, n + floatv(0.5f)));
+    //x = r + n pi + pi/2, cos(x) = -sin(r) for even n
+    return select(mod(n, 2.f) == floatv(1.f), u, -u);
+}
+inline floatv tan(floatv x) { return sin(x) / cos(x); }
+
+//no paintings lean on these enough for a polynomial of their own yet, they go lane by lane
+inline floatv asin(floatv x) { return simdLanewise(x, std::asin); }
+inline floatv acos(floatv x) { return simdLanewise(x, std::acos); }
+inline floatv atan(floatv x) { return simdLanewise(x, std::atan); }
+inline floatv atan(floatv y, floatv x) { return simdLanewise(y, x, std::atan2); }
+inline floatv exp(floatv x) { return simdLanewise(x, std::exp); }
+inline floatv log(floatv x) { return simdLanewise(x, std::log); }
+inline floatv exp2(floatv x) { return simdLanewise(x, std::exp2); }
+inline floatv log2(floatv x) { return simdLanewise(x, std::log2); }
+inline floatv pow(floatv x, floatv y) { return simdLanewise(x, y, std::pow); }
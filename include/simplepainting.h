@@ -1,7 +1,12 @@
+#pragma once
 #include "painting.h"
 
+//a painting that is just a fragment shader on the shared quad; its program is built with INSTANCED
+//so paintings sharing a shader get drawn together by PaintingBatch
 class SimplePainting: public Painting {
     public:
         SimplePainting(const char* vshaderpath, const char* fshaderpath);
+        void resolveUniforms() {};
+        bool instanceable() const { return true; }
         void render(GLuint VAO);
 };
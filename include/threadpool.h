@@ -0,0 +1,34 @@
+#pragma once
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+
+//a fixed set of threads for data-parallel loops (the CPU shaders): run() hands out the indices
+//of one job one at a time, so uneven pieces of work still keep every thread busy
+class ThreadPool {
+    private:
+        std::vector<std::thread> threads;
+        std::mutex poolMutex;
+        std::condition_variable poolCond;
+        std::function<void(int)> job;
+        int count;
+        std::atomic<int> next;
+        int working;            //threads still inside the current job
+        long generation;        //bumped for every job, so a thread never runs the same one twice
+        bool stopping;
+
+        void threadLoop();
+        void work();
+    public:
+        //threads <= 0 is one per core. The calling thread works too, so it starts one less
+        explicit ThreadPool(int threads);
+        ~ThreadPool();
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+        //job(i) for every i in [0, count), returns when they're all done
+        void run(int count, const std::function<void(int)> &job);
+        int size() const { return (int)threads.size() + 1; }
+};
@@ -1,9 +1,7 @@
 #version 400
-#extension GL_ARB_explicit_uniform_location : enable
 
 #define PI 3.141592
 
-layout(location = 2) uniform float time;
 in vec3 interpolatedColor;
 in vec2 fraguv;
 out vec4 fragColor;
@@ -1,19 +1,42 @@
 #version 400
-#extension GL_ARB_explicit_uniform_location : enable
 
-uniform mat4 projectionMatrix;
-uniform mat4 viewMatrix;
+#ifdef INSTANCED
+//per-instance data, see PaintingBatch (locations 4-7 hold the matrix columns)
+layout(location = 4) in mat4 modelMatrix;
+layout(location = 8) in vec4 instanceParams;
+flat out vec4 paintingParams;
+#else
 uniform mat4 modelMatrix;
-layout(location = 2) uniform float time;
+#endif
+
+#ifdef TILED
+//poster tiles (see renderPoster): the quad fills the viewport and shows only the uvRect part of the painting,
+//xy where it starts and zw its size
+uniform vec4 uvRect;
+#endif
 
 layout(location = 0) in vec3 position;
 layout(location = 1) in vec3 color;
 layout(location = 2) in vec2 uv;
 out vec3 interpolatedColor;
 out vec2 fraguv;
+//the depth prepass draws us with depth.frag.glsl, positions must come out bit-identical
+invariant gl_Position;
 
 void main(void) {
     interpolatedColor = color;
+#ifdef TILED
+    fraguv = uvRect.xy + uv * uvRect.zw;
+#else
     fraguv = uv;
-    gl_Position = projectionMatrix * viewMatrix * modelMatrix * vec4(position, 1.0);
+#endif
+#ifdef INSTANCED
+    paintingParams = instanceParams;
+#endif
+#ifdef TILED
+    //v grows downwards on the painting, as it does on the quad in the gallery
+    gl_Position = vec4(uv.x * 2.0 - 1.0, 1.0 - uv.y * 2.0, 0.0, 1.0);
+#else
+    gl_Position = viewProjectionMatrix * modelMatrix * vec4(position, 1.0);
+#endif
 }
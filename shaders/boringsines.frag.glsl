@@ -1,12 +1,10 @@
 #version 400
-#extension GL_ARB_explicit_uniform_location : enable
 
 const float PI = 3.1415926535897932384626433832795;
 const vec3 BLUE = vec3(0.15, 0.34, 0.67);
 const vec3 MAGENTA = vec3(0.75, 0.1, 0.54);
 
 
-layout(location = 2) uniform float time;
 in vec3 interpolatedColor;
 in vec2 fraguv;
 out vec4 fragColor;
@@ -0,0 +1,12 @@
+#version 400
+
+uniform sampler2D painting;
+
+in vec3 interpolatedColor;
+in vec2 fraguv;
+out vec4 fragColor;
+
+void main(void) {
+    //the quad's uv has v = 1 at the bottom, and that's the row PaintingCache renders first (texture t = 0)
+    fragColor = texture(painting, vec2(fraguv.x, 1.0 - fraguv.y));
+}
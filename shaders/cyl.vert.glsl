@@ -1,9 +1,5 @@
 #version 400
-#extension GL_ARB_explicit_uniform_location : enable
 
-
-uniform mat4 projectionMatrix;
-uniform mat4 viewMatrix;
 uniform mat4 modelMatrix;
 
 layout(location = 0) in vec3 position;
@@ -12,5 +8,5 @@ out vec2 fraguv;
 
 void main(void) {
     fraguv = uv;
-    gl_Position = projectionMatrix * viewMatrix * modelMatrix * vec4(position, 1.0);
+    gl_Position = viewProjectionMatrix * modelMatrix * vec4(position, 1.0);
 }
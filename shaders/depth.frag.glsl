@@ -0,0 +1,5 @@
+#version 400
+
+//depth prepass: nothing to write but depth, so the cheapest fragment shader there is
+void main(void) {
+}
@@ -1,18 +1,37 @@
 #version 400
-#extension GL_ARB_explicit_uniform_location : enable
 
-uniform mat4 projectionMatrix;
-uniform mat4 viewMatrix;
+#ifdef INSTANCED
+//per-instance model matrix, see GeometryBatch (locations 4-7 hold the columns)
+layout(location = 4) in mat4 modelMatrix;
+#else
 uniform mat4 modelMatrix;
+#endif
 
 layout(location = 0) in vec3 position;
 layout(location = 2) in vec2 uv;
+#ifdef QUANTIZED
+//Geometry's compact layout: position is unorm16 in the mesh's box (modelMatrix maps it back),
+//uv arrives as half floats, the normal octahedral encoded in two snorm16
+layout(location = 3) in vec2 octNormal;
+
+vec3 decodeNormal(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0) n.xy = (1.0 - abs(n.yx)) * mix(vec2(-1.0), vec2(1.0), greaterThanEqual(n.xy, vec2(0.0)));
+    return normalize(n);
+}
+#else
 layout(location = 3) in vec3 normal;
+#endif
 out vec3 interpolatedColor;
 out vec2 fraguv;
+//the depth prepass draws us with depth.frag.glsl, positions must come out bit-identical
+invariant gl_Position;
 
 void main(void) {
+#ifdef QUANTIZED
+    vec3 normal = decodeNormal(octNormal);
+#endif
     interpolatedColor = vec3(0.5, 0.5, 0.5) * abs(dot(normal , normalize(vec3(10., 10., 10.))));
     fraguv = uv;
-    gl_Position = projectionMatrix * viewMatrix * modelMatrix * vec4(position, 1.0);
+    gl_Position = viewProjectionMatrix * modelMatrix * vec4(position, 1.0);
 }
@@ -0,0 +1,13 @@
+// per-frame values shared by every program, written once per frame into a single UBO.
+// shader_prog pastes this block right after the #version line of every shader it loads,
+// so shaders can just use time, viewMatrix etc. without declaring them.
+// must stay in sync with struct FrameGlobals in include/frameglobals.h (std140 layout)
+layout(std140) uniform FrameGlobals {
+    mat4 viewMatrix;
+    mat4 projectionMatrix;
+    mat4 viewProjectionMatrix;
+    float time;
+    float dt;
+    vec2 resolution;
+    int frame;
+};
@@ -1,11 +1,9 @@
 #version 400
-#extension GL_ARB_explicit_uniform_location : enable
 
 const float PI = 3.1415926535897932384626433832795;
 const float N = 10.;
 
 
-layout(location = 2) uniform float time;
 in vec3 interpolatedColor;
 in vec2 fraguv;
 out vec4 fragColor;
@@ -0,0 +1,11 @@
+#version 400
+
+//2d overlays in pixels from the top left corner of the screen
+layout(location = 0) in vec2 position;
+layout(location = 1) in vec3 color;
+out vec3 interpolatedColor;
+
+void main(void) {
+    interpolatedColor = color;
+    gl_Position = vec4(position / resolution * vec2(2.0, -2.0) + vec2(-1.0, 1.0), 0.0, 1.0);
+}
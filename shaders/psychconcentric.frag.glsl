@@ -1,7 +1,4 @@
 #version 400
-#extension GL_ARB_explicit_uniform_location : enable
-
-layout (location = 2) uniform float time;
 
 in vec3 interpolatedColor;
 in vec2 fraguv;
@@ -1,5 +1,4 @@
 #version 400
-uniform float time;
 
 in vec3 interpolatedColor;
 in vec2 fraguv;
@@ -0,0 +1,148 @@
+#include "benchmark.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <unistd.h>
+
+namespace {
+    struct Summary {
+        double mean, median, p95, p99, max;
+    };
+
+    //nearest rank percentiles
+    Summary summarize(std::vector<double> values) {
+        Summary s = {0, 0, 0, 0, 0};
+        if (values.empty()) return s;
+        std::sort(values.begin(), values.end());
+        double sum = 0;
+        for (double v : values) sum += v;
+        //the ceil(p * n)th smallest, counting from 1. The epsilon keeps p * n that should be a whole
+        //number but comes out a hair above it (p isn't exact in binary) from landing one rank high
+        auto rank = [&](double p) {
+            size_t r = (size_t)std::ceil(p * values.size() - 1e-9);
+            return values[std::min(values.size() - 1, r > 0 ? r - 1 : 0)];
+        };
+        s.mean = sum / values.size();
+        s.median = rank(0.5);
+        s.p95 = rank(0.95);
+        s.p99 = rank(0.99);
+        s.max = values.back();
+        return s;
+    }
+
+    void writeSummary(FILE *out, const char *name, const Summary &s, bool last) {
+        fprintf(out, "  \"%s\": {\"mean\": %.4f, \"median\": %.4f, \"p95\": %.4f, \"p99\": %.4f, \"max\": %.4f}%s\n",
+                name, s.mean, s.median, s.p95, s.p99, s.max, last ? "" : ",");
+    }
+
+    void writeString(FILE *out, const std::string &str) {
+        fputc('"', out);
+        for (char c : str) {
+            if (c == '"' || c == '\\') fputc('\\', out);
+            if ((unsigned char)c >= 0x20) fputc(c, out);
+        }
+        fputc('"', out);
+    }
+}
+
+Benchmark::Benchmark() : out(NULL) {
+    for (int i = 0; i < BENCHMARK_QUERY_FRAMES; i++) pending[i] = -1;
+}
+
+void Benchmark::init() {
+    glGenQueries(2 * BENCHMARK_QUERY_FRAMES, &queries[0][0]);
+}
+
+void Benchmark::collect(int slot) {
+    if (pending[slot] < 0) return;
+    //by the time a slot comes round again this is normally long done, otherwise it waits
+    GLuint64 start, end;
+    glGetQueryObjectui64v(queries[slot][0], GL_QUERY_RESULT, &start);
+    glGetQueryObjectui64v(queries[slot][1], GL_QUERY_RESULT, &end);
+    samples[pending[slot]].gpuMs = (end - start) / 1e6;
+    pending[slot] = -1;
+}
+
+void Benchmark::beginFrame() {
+    int slot = samples.size() % BENCHMARK_QUERY_FRAMES;
+    collect(slot);
+    frameStart = std::chrono::steady_clock::now();
+    glQueryCounter(queries[slot][0], GL_TIMESTAMP);
+}
+
+void Benchmark::endFrame(const RenderStats &stats, const GLDispatchStats &gl) {
+    int slot = samples.size() % BENCHMARK_QUERY_FRAMES;
+    glQueryCounter(queries[slot][1], GL_TIMESTAMP);
+    double cpu = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count();
+    pending[slot] = samples.size();
+    samples.push_back(FrameSample{cpu, -1.0, stats.drawCalls, stats.programBinds,
+                                  gl.totalCalls(), gl.totalRedundant(), gl.bytes});
+}
+
+void Benchmark::finish() {
+    for (int i = 0; i < BENCHMARK_QUERY_FRAMES; i++) collect(i);
+}
+
+void Benchmark::claimStdout() {
+    fflush(stdout);
+    int fd = dup(1);
+    dup2(2, 1);
+    out = fd >= 0 ? fdopen(fd, "w") : NULL;
+}
+
+bool Benchmark::write(const char *filename, const std::string &renderer, int width, int height, const char *clock) {
+    bool toStdout = !filename || strcmp(filename, "-") == 0;
+    if (!toStdout) out = fopen(filename, "w");
+    else if (!out) out = stdout;
+    if (!out) {
+        printf("Can't write benchmark report %s\n", filename);
+        return false;
+    }
+
+    size_t len = toStdout ? 0 : strlen(filename);
+    if (len > 4 && strcmp(filename + len - 4, ".csv") == 0) {
+        fprintf(out, "frame,cpu_ms,gpu_ms,draw_calls,program_binds%s\n",
+                glDispatchEnabled() ? ",gl_calls,gl_redundant,gl_bytes" : "");
+        for (size_t i = 0; i < samples.size(); i++) {
+            const FrameSample &s = samples[i];
+            fprintf(out, "%zu,%.4f,%.4f,%u,%u", i, s.cpuMs, s.gpuMs, s.drawCalls, s.programBinds);
+            if (glDispatchEnabled()) {
+                fprintf(out, ",%llu,%llu,%llu", (unsigned long long)s.glCalls,
+                        (unsigned long long)s.glRedundant, (unsigned long long)s.glBytes);
+            }
+            fprintf(out, "\n");
+        }
+    } else {
+        std::vector<double> cpu, gpu, draws, binds, glCalls, glRedundant, glBytes;
+        for (const FrameSample &s : samples) {
+            cpu.push_back(s.cpuMs);
+            if (s.gpuMs >= 0) gpu.push_back(s.gpuMs);
+            draws.push_back(s.drawCalls);
+            binds.push_back(s.programBinds);
+            glCalls.push_back(s.glCalls);
+            glRedundant.push_back(s.glRedundant);
+            glBytes.push_back(s.glBytes);
+        }
+        fprintf(out, "{\n  \"renderer\": ");
+        writeString(out, renderer);
+        fprintf(out, ",\n  \"resolution\": [%d, %d],\n  \"clock\": ", width, height);
+        writeString(out, clock);
+        fprintf(out, ",\n  \"frames\": %zu,\n", samples.size());
+        writeSummary(out, "cpu_ms", summarize(cpu), false);
+        writeSummary(out, "gpu_ms", summarize(gpu), false);
+        writeSummary(out, "draw_calls", summarize(draws), false);
+        writeSummary(out, "program_binds", summarize(binds), !glDispatchEnabled());
+        if (glDispatchEnabled()) {
+            writeSummary(out, "gl_calls", summarize(glCalls), false);
+            writeSummary(out, "gl_redundant", summarize(glRedundant), false);
+            writeSummary(out, "gl_bytes", summarize(glBytes), true);
+        }
+        fprintf(out, "}\n");
+    }
+
+    bool ok = out == stdout ? fflush(out) == 0 : fclose(out) == 0;
+    out = NULL;
+    if (!ok) printf("Can't write benchmark report %s\n", toStdout ? "to stdout" : filename);
+    return ok;
+}
@@ -89,4 +89,9 @@
 
     }
 
-
+    //puts the camera somewhere directly instead of walking it there, for scripted camera paths
+    void Camera::setPose(glm::vec3 position, glm::vec2 rot) {
+        worldpos = position;
+        rotation = rot;
+        updateViewMat();
+    }
@@ -0,0 +1,77 @@
+#include "camerapath.h"
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+bool CameraPath::load(const char *filename) {
+    std::ifstream in(filename);
+    if (!in) {
+        printf("Can't read camera path %s\n", filename);
+        return false;
+    }
+    keys.clear();
+    std::string line;
+    int lineno = 0;
+    while (std::getline(in, line)) {
+        lineno++;
+        line = line.substr(0, line.find('#'));
+        if (line.find_first_not_of(" \t\r") == std::string::npos) continue;
+        std::istringstream fields(line);
+        CameraKey k;
+        if (!(fields >> k.position.x >> k.position.y >> k.position.z >> k.rotation.x >> k.rotation.y)) {
+            printf("%s:%d: expected x y z yaw pitch\n", filename, lineno);
+            return false;
+        }
+        keys.push_back(k);
+    }
+    if (keys.size() < 2) {
+        printf("Camera path %s needs at least two keys\n", filename);
+        return false;
+    }
+    return true;
+}
+
+void CameraPath::gallery() {
+    //the paintings hang at z = -30 from x = -80 every 40 units, the dome floats at (0, 30, 20)
+    //(yaw 0 looks down -z at the wall, positive yaw turns left, positive pitch looks up)
+    keys = {
+        {glm::vec3(-100.f,  8.f, 10.f), glm::vec2(-30.f,  0.f)},
+        {glm::vec3( -40.f,  8.f,  0.f), glm::vec2(-10.f, -5.f)},
+        {glm::vec3(  40.f,  6.f, -5.f), glm::vec2( 10.f,  0.f)},
+        {glm::vec3( 120.f,  8.f,  5.f), glm::vec2(-20.f,  5.f)},
+        {glm::vec3( 200.f,  8.f, 10.f), glm::vec2( 20.f,  0.f)},
+        {glm::vec3( 280.f,  8.f,  0.f), glm::vec2(-30.f,  0.f)},
+        {glm::vec3( 320.f, 12.f, 25.f), glm::vec2( 90.f, 10.f)},
+        {glm::vec3( 150.f, 15.f, 60.f), glm::vec2( 30.f,  5.f)},
+        {glm::vec3(  20.f, 20.f, 70.f), glm::vec2( 20.f, 10.f)},
+        {glm::vec3( -60.f, 10.f, 40.f), glm::vec2(-45.f,  0.f)},
+    };
+}
+
+namespace {
+    //uniform Catmull-Rom between b and c, a and d being the neighbours
+    template <typename T>
+    T catmullRom(const T &a, const T &b, const T &c, const T &d, float t) {
+        float t2 = t * t, t3 = t2 * t;
+        return 0.5f * ((2.f * b) + (c - a) * t + (2.f * a - 5.f * b + 4.f * c - d) * t2 + (3.f * b - a - 3.f * c + d) * t3);
+    }
+}
+
+CameraKey CameraPath::sample(float u) const {
+    if (keys.empty()) return CameraKey{glm::vec3(0), glm::vec2(0)};
+    if (keys.size() == 1) return keys[0];
+    u = glm::clamp(u, 0.f, 1.f);
+    float f = u * (keys.size() - 1);
+    int i = glm::min((int)f, (int)keys.size() - 2);
+    float t = f - i;
+    //the ends repeat their key so the spline starts and stops exactly on them
+    const CameraKey &k0 = keys[i > 0 ? i - 1 : 0];
+    const CameraKey &k1 = keys[i];
+    const CameraKey &k2 = keys[i + 1];
+    const CameraKey &k3 = keys[glm::min(i + 2, (int)keys.size() - 1)];
+    return CameraKey{
+        catmullRom(k0.position, k1.position, k2.position, k3.position, t),
+        catmullRom(k0.rotation, k1.rotation, k2.rotation, k3.rotation, t)
+    };
+}
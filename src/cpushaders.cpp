@@ -0,0 +1,196 @@
+#include "cpushaders.h"
+#include "threadpool.h"
+#include "profiler.h"
+#include <cstring>
+#include <string>
+#include <vector>
+#include <utility>
+#include <algorithm>
+
+namespace {
+    const float PI = 3.1415926535897932384626433832795f;
+
+    //rainy.frag.glsl
+    floatv rainyRand(floatv x) {
+        return fract(sin(x * 133.f) * 1152.13f);
+    }
+
+    void rainy(floatv u, floatv v, float time, floatv &r, floatv &g, floatv &b) {
+        //uv *= rotate2d(2.816), a row vector times mat2(-cos, -sin, sin, cos)
+        const float c = std::cos(2.816f), s = std::sin(2.816f);
+        v = v * 2.f;
+        floatv x = u * -c + v * -s;
+        floatv y = u * s + v * c;
+
+        floatv stat = rainyRand(floor(x * 500.f));
+        floatv stat2 = (sin(rainyRand(floor(x * 500.f))) - floatv(0.2f)) * PI;
+        floatv moving1 = clamp(sin(floatv(time * 9.592f) * stat + y * (floatv(7.096f) / (stat + floatv(-2.336f)))) - floatv(0.9f), 0.f, 1.008f) * 7.960f;
+        floatv moving2 = clamp(sin(floatv(time * 5.112f) * stat2 + y * (floatv(7.096f) / (stat2 + floatv(-0.344f)))) - floatv(0.95f), 0.f, 1.f) * 20.f;
+
+        //moving1 * purp * stat + moving2 * green * stat2
+        floatv a = moving1 * stat, d = moving2 * stat2;
+        r = a * 0.5f;
+        g = d * 0.6f;
+        b = a + d * 0.3f;
+    }
+
+    //joydivision.frag.glsl
+    floatv joyRand(floatv n) {
+        return fract(sin(n) * 35758.453123f);
+    }
+
+    floatv joyNoise(floatv p) {
+        floatv fl = floor(p);
+        floatv fc = fract(p);
+        return mix(joyRand(fl), joyRand(fl + floatv(1.f)), smoothstep(0.f, 1.f, fc));
+    }
+
+    floatv makeline(floatv center, floatv epsilon, floatv y) {
+        return smoothstep(center - epsilon, center, y) - smoothstep(center, center + epsilon, y);
+    }
+
+    void joydivision(floatv u, floatv v, float time, floatv &r, floatv &g, floatv &b) {
+        v = floatv(1.f) - v;
+        floatv f(0.f);
+        //the same for every line
+        floatv lengthwise = u * 30.f + floatv(time);
+        floatv x = (floatv(0.5f) - u) * 2.f;
+        floatv envelope = min(cos(x * (PI / 2.f)), floatv(1.f) - abs(x));
+        envelope = envelope * envelope;
+        envelope = envelope * envelope;
+        for (float i = 1.f; i <= 10.f; i++) {
+            floatv amplitude = envelope * (0.16f - 0.005f * i);
+            float yshift = 0.7f - 0.06f * i;
+            float linewidth = 0.01f - 0.0001f * i;
+            f = f + makeline(joyNoise(lengthwise * i) * amplitude + floatv(yshift), linewidth, v);
+        }
+        r = 0.f;
+        g = f * 0.8f;
+        b = f * 0.3f;
+    }
+
+    //canvas.frag.glsl, everything that depends only on time is worked out once per call
+    float canvasFlipflop(float step) {
+        return std::fmod(step, 2.f) == 1.f ? -1.f : 1.f;
+    }
+
+    float canvasRand(float seed) {
+        float s = std::sin(seed * 11245.432f);
+        return std::floor((s - std::floor(s)) * 2.f) + 1.f;
+    }
+
+    floatv colrand(floatv seed) {
+        return fract(sin(seed * 15145.432f));
+    }
+
+    void canvas(floatv u, floatv v, float time, floatv &r, floatv &g, floatv &b) {
+        float step = std::fmod(std::floor(time * 2.f), 45.f) + 1.f;
+        u = (u * 2.f - floatv(1.f)) * (0.1f * step);
+        v = (v * 2.f - floatv(1.f)) * (0.1f * step);
+
+        floatv fcx = fract(u) * 2.f - floatv(1.f), fcy = fract(v) * 2.f - floatv(1.f);
+        floatv fix = floor(u), fiy = floor(v);
+        floatv f(0.f);
+        for (float i = 0.f; i < 4.f; i++) {
+            float s = std::sin(canvasFlipflop(canvasRand(step)) * time + PI * i / 2.f) * 0.35f;
+            float c = std::cos(canvasFlipflop(step) * time + PI * i / 2.f) * 0.35f;
+            floatv dx = fcx + floatv(s), dy = fcy + floatv(c);
+            f = f + floatv(0.012f) / abs(sqrt(dx * dx + dy * dy) - floatv(0.6f));
+        }
+        r = colrand(floatv(step * 500.f)) * f;
+        g = colrand(fiy + floatv(step * 200.f)) * f;
+        b = colrand(fix + floatv(step * 200.f)) * f * 0.5f;
+    }
+
+    //pulsingcircles.frag.glsl, the radii only change with time
+    floatv circle(floatv u, floatv v, float radius, float cx, float cy) {
+        floatv dx = u - floatv(cx), dy = v - floatv(cy);
+        return floatv(1.f) - smoothstep(radius - radius * 0.01f, radius + radius * 0.01f, (dx * dx + dy * dy) * 4.f);
+    }
+
+    void pulsingcircles(floatv u, floatv v, float time, floatv &r, floatv &g, floatv &b) {
+        const float pi = 3.141592653f;
+        floatv c1 = circle(u, v, 0.3f + std::pow(std::fabs(std::sin(time)), 3.f) * 0.8f, 0.800f, 0.820f);
+        floatv c2 = circle(u, v, (0.3f + std::pow(std::fabs(std::sin(pi * 0.5f + time)), 4.f)) * 0.076f, 0.230f, 0.550f);
+        floatv c3 = circle(u, v, (0.2f + std::pow(std::fabs(std::sin(pi + time)), 6.f)) * 0.2f, 0.300f, 0.130f);
+        floatv c4 = circle(u, v, (0.2f + std::pow(std::fabs(std::sin(pi * 0.5f + time)), 3.f)) * 0.2f, 0.740f, 0.240f);
+        floatv c5 = circle(u, v, (0.2f + std::pow(std::fabs(std::sin(pi * 0.5f + time)), 2.f)) * 0.328f, 0.630f, 0.540f);
+        floatv c6 = circle(u, v, (0.6f + std::pow(std::fabs(std::sin(pi * 0.5f + time)), 3.f)) * 0.704f, 0.060f, 0.920f);
+        r = c4 + c6;
+        g = c2 + c5;
+        b = c3 + c1;
+    }
+
+    const struct {
+        const char *name;
+        CpuShader shader;
+    } cpuShaders[] = {
+        {"rainy", rainy},
+        {"joydivision", joydivision},
+        {"canvas", canvas},
+        {"pulsingcircles", pulsingcircles},
+    };
+
+    //the translated ones, filled in before main by static initializers so it has to be built on first use
+    std::vector<std::pair<std::string, CpuShader>> &registered() {
+        static std::vector<std::pair<std::string, CpuShader>> shaders;
+        return shaders;
+    }
+
+    //as the framebuffer stores it: clamped, then rounded to the nearest of 256 steps
+    unsigned char unorm8(float c) {
+        c = c > 0.f ? (c < 1.f ? c : 1.f) : 0.f;
+        return (unsigned char)(c * 255.f + 0.5f);
+    }
+}
+
+CpuShader cpuShader(const char *fragshader) {
+    std::string name(fragshader);
+    size_t slash = name.rfind('/');
+    if (slash != std::string::npos) name.erase(0, slash + 1);
+    size_t ext = name.find(".frag");
+    if (ext != std::string::npos) name.erase(ext);
+    for (const auto &s : cpuShaders) {
+        if (name == s.name) return s.shader;
+    }
+    for (const auto &s : registered()) {
+        if (name == s.first) return s.second;
+    }
+    return NULL;
+}
+
+void registerCpuShader(const char *name, CpuShader shader) {
+    registered().push_back({name, shader});
+}
+
+void cpuShade(ThreadPool &pool, CpuShader shader, float time, int width, int height,
+              int x0, int y0, int w, int h, unsigned char *rgba, int stride) {
+    PROFILE_ZONE("cpuShade");
+    int across = (w + CPU_TILE - 1) / CPU_TILE, down = (h + CPU_TILE - 1) / CPU_TILE;
+    pool.run(across * down, [=](int t) {
+        int tx = t % across * CPU_TILE, ty = t / across * CPU_TILE;
+        int tw = std::min(CPU_TILE, w - tx), th = std::min(CPU_TILE, h - ty);
+        float lanes[SIMD_WIDTH], out[3][SIMD_WIDTH];
+        for (int y = ty; y < ty + th; y++) {
+            //pixel centers, where the rasterizer samples fraguv
+            floatv v((y0 + y + 0.5f) / height);
+            unsigned char *row = rgba + (size_t)y * stride;
+            for (int x = tx; x < tx + tw; x += SIMD_WIDTH) {
+                for (int i = 0; i < SIMD_WIDTH; i++) lanes[i] = (x0 + x + i + 0.5f) / width;
+                floatv r, g, b;
+                shader(floatv::load(lanes), v, time, r, g, b);
+                r.store(out[0]);
+                g.store(out[1]);
+                b.store(out[2]);
+                //the last lanes of a tile's row can hang over its edge
+                for (int i = 0; i < SIMD_WIDTH && x + i < tx + tw; i++) {
+                    unsigned char *p = row + (x + i) * 4;
+                    p[0] = unorm8(out[0][i]);
+                    p[1] = unorm8(out[1][i]);
+                    p[2] = unorm8(out[2][i]);
+                    p[3] = 255;
+                }
+            }
+        }
+    });
+}
@@ -0,0 +1,340 @@
+#include "exporter.h"
+#include "profiler.h"
+#include <cstring>
+#include <cctype>
+#include <algorithm>
+#include <chrono>
+#include <unistd.h>
+
+namespace {
+    double seconds(std::chrono::steady_clock::time_point since) {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - since).count();
+    }
+
+    //bottom-up RGBA as read back to top-down RGB
+    void toRGB(const unsigned char *rgba, int width, int height, std::vector<unsigned char> &rgb) {
+        rgb.resize((size_t)width * height * 3);
+        for (int y = 0; y < height; y++) {
+            const unsigned char *src = rgba + (size_t)(height - 1 - y) * width * 4;
+            unsigned char *dst = &rgb[(size_t)y * width * 3];
+            for (int x = 0; x < width; x++) {
+                dst[x * 3] = src[x * 4];
+                dst[x * 3 + 1] = src[x * 4 + 1];
+                dst[x * 3 + 2] = src[x * 4 + 2];
+            }
+        }
+    }
+
+    unsigned int crc32(const unsigned char *data, size_t len, unsigned int crc = 0) {
+        static unsigned int table[256];
+        static bool tableReady = [] {
+            for (unsigned int n = 0; n < 256; n++) {
+                unsigned int c = n;
+                for (int k = 0; k < 8; k++) c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                table[n] = c;
+            }
+            return true;
+        }();
+        (void)tableReady;
+        crc = ~crc;
+        for (size_t i = 0; i < len; i++) crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+        return ~crc;
+    }
+
+    void put32(std::vector<unsigned char> &out, unsigned int v) {
+        out.push_back(v >> 24);
+        out.push_back(v >> 16);
+        out.push_back(v >> 8);
+        out.push_back(v);
+    }
+
+    bool writeChunk(FILE *f, const char *type, const std::vector<unsigned char> &data) {
+        std::vector<unsigned char> chunk;
+        chunk.reserve(data.size() + 12);
+        put32(chunk, data.size());
+        chunk.insert(chunk.end(), type, type + 4);
+        chunk.insert(chunk.end(), data.begin(), data.end());
+        put32(chunk, crc32(&chunk[4], data.size() + 4));
+        return fwrite(chunk.data(), 1, chunk.size(), f) == chunk.size();
+    }
+
+    //deflate with stored blocks only: no zlib to link, and no time spent compressing on a thread
+    //that has to keep up with the GPU. Pipe y4m or raw into an encoder for small files
+    bool writePNG(FILE *f, const unsigned char *rgb, int width, int height) {
+        static const unsigned char signature[8] = {137, 'P', 'N', 'G', '\r', '\n', 26, '\n'};
+        std::vector<unsigned char> header;
+        put32(header, width);
+        put32(header, height);
+        const unsigned char rest[5] = {8, 2, 0, 0, 0};    //8 bit, RGB, deflate, no filter, no interlace
+        header.insert(header.end(), rest, rest + 5);
+
+        size_t rowBytes = (size_t)width * 3 + 1, rawSize = rowBytes * height;
+        std::vector<unsigned char> raw(rawSize);
+        for (int y = 0; y < height; y++) {
+            raw[y * rowBytes] = 0;
+            memcpy(&raw[y * rowBytes + 1], rgb + (size_t)y * width * 3, width * 3);
+        }
+        unsigned int a = 1, b = 0;
+        for (unsigned char c : raw) {
+            a = (a + c) % 65521;
+            b = (b + a) % 65521;
+        }
+
+        std::vector<unsigned char> idat;
+        idat.reserve(rawSize + rawSize / 65535 * 5 + 16);
+        idat.push_back(0x78);
+        idat.push_back(0x01);
+        for (size_t at = 0; at < rawSize; at += 65535) {
+            size_t len = std::min(rawSize - at, (size_t)65535);
+            idat.push_back(at + len >= rawSize);
+            idat.push_back(len & 0xFF);
+            idat.push_back(len >> 8);
+            idat.push_back(~len & 0xFF);
+            idat.push_back((~len >> 8) & 0xFF);
+            idat.insert(idat.end(), raw.begin() + at, raw.begin() + at + len);
+        }
+        put32(idat, (b << 16) | a);
+
+        return fwrite(signature, 1, 8, f) == 8 && writeChunk(f, "IHDR", header) && writeChunk(f, "IDAT", idat)
+               && writeChunk(f, "IEND", std::vector<unsigned char>());
+    }
+
+    //full 4:4:4 planes, so odd sizes work and nothing is lost before the encoder sees it.
+    //BT.601 studio range, which is what players assume for y4m
+    bool writeY4MFrame(FILE *f, const unsigned char *rgba, int width, int height, std::vector<unsigned char> &planes) {
+        size_t n = (size_t)width * height;
+        planes.resize(n * 3);
+        for (int y = 0; y < height; y++) {
+            const unsigned char *src = rgba + (size_t)(height - 1 - y) * width * 4;
+            for (int x = 0; x < width; x++) {
+                int r = src[x * 4], g = src[x * 4 + 1], b = src[x * 4 + 2];
+                size_t i = (size_t)y * width + x;
+                planes[i] = ((66 * r + 129 * g + 25 * b + 128) >> 8) + 16;
+                planes[n + i] = ((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128;
+                planes[2 * n + i] = ((112 * r - 94 * g - 18 * b + 128) >> 8) + 128;
+            }
+        }
+        return fputs("FRAME\n", f) >= 0 && fwrite(planes.data(), 1, planes.size(), f) == planes.size();
+    }
+
+    //one integer conversion (%d, %05d, ...) and nothing else for snprintf to trip over
+    bool validPattern(const std::string &pattern) {
+        size_t at = pattern.find('%');
+        if (at == std::string::npos || pattern.find('%', at + 1) != std::string::npos) return false;
+        size_t i = at + 1;
+        while (i < pattern.size() && isdigit((unsigned char)pattern[i])) i++;
+        return i < pattern.size() && pattern[i] == 'd';
+    }
+}
+
+Exporter::Exporter() :
+    format(RAW),
+    width(0),
+    height(0),
+    fps(60),
+    stream(NULL),
+    firstFrame(0),
+    captured(0),
+    written(0),
+    gpuWait(0.),
+    writerWait(0.),
+    failed(false),
+    finishing(false)
+    {}
+
+//the stream gets the real stdout, everything printed from then on goes to stderr
+std::string Exporter::framePattern(const std::string &file) {
+    //one file per frame, numbered
+    std::string name(file);
+    if (name.find('%') == std::string::npos) {
+        size_t dot = name.rfind('.');
+        name.insert(dot == std::string::npos ? name.size() : dot, "_%05d");
+    }
+    return name;
+}
+
+void Exporter::claimStdout() {
+    fflush(stdout);
+    int fd = dup(1);
+    dup2(2, 1);
+    stream = fd >= 0 ? fdopen(fd, "wb") : NULL;
+}
+
+bool Exporter::open(const char *file, const char *formatName, int w, int h, int framesPerSecond, long first) {
+    std::string name(file);
+    std::string ext = name.size() > 4 ? name.substr(name.size() - 4) : "";
+    std::string fmt = formatName ? formatName : name == "-" ? "raw" : ext.size() == 4 && ext[0] == '.' ? ext.substr(1) : "";
+    if (fmt == "png") format = PNG;
+    else if (fmt == "ppm") format = PPM;
+    else if (fmt == "y4m") format = Y4M;
+    else if (fmt == "raw") format = RAW;
+    else {
+        printf("Export: unknown format for %s, use --export-format png|ppm|y4m|raw\n", file);
+        return false;
+    }
+
+    if (format == PNG || format == PPM) {
+        name = framePattern(name);
+        if (!validPattern(name)) {
+            printf("Export: %s needs a single %%d for the frame number\n", file);
+            return false;
+        }
+    } else if (name == "-") {
+        if (!stream) claimStdout();
+    } else {
+        stream = fopen(name.c_str(), "wb");
+    }
+    if ((format == Y4M || format == RAW) && !stream) {
+        printf("Export: can't open %s\n", file);
+        return false;
+    }
+    if (format == Y4M) fprintf(stream, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C444\n", w, h, framesPerSecond);
+
+    path = name;
+    width = w;
+    height = h;
+    fps = framesPerSecond;
+    firstFrame = first;
+    for (Slot &s : slots) {
+        glGenBuffers(1, &s.pbo);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, s.pbo);
+        glBufferData(GL_PIXEL_PACK_BUFFER, (size_t)width * height * 4, NULL, GL_STREAM_READ);
+        s.fence = 0;
+        s.frame = -1;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    finishing = false;
+    writer = std::thread(&Exporter::writerLoop, this);
+    printf("Export: %dx%d %s to %s\n", width, height, fmt.c_str(), file);
+    return true;
+}
+
+void Exporter::capture() {
+    PROFILE_ZONE("export capture");
+    Slot &s = slots[captured % EXPORT_PBO_COUNT];
+    if (s.frame >= 0) collect(s);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, s.pbo);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    s.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    s.frame = firstFrame + captured++;
+}
+
+//copies a finished readback out of its PBO and queues it for the writer
+void Exporter::collect(Slot &s) {
+    auto started = std::chrono::steady_clock::now();
+    GLenum status;
+    do {
+        status = glClientWaitSync(s.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+    } while (status == GL_TIMEOUT_EXPIRED);
+    glDeleteSync(s.fence);
+    s.fence = 0;
+    gpuWait += seconds(started);
+
+    Frame f;
+    f.index = s.frame;
+    {
+        started = std::chrono::steady_clock::now();
+        std::unique_lock<std::mutex> lock(queueMutex);
+        queueCond.wait(lock, [this] { return queue.size() < EXPORT_QUEUE_FRAMES; });
+        if (!spare.empty()) {
+            f.pixels.swap(spare.back());
+            spare.pop_back();
+        }
+        writerWait += seconds(started);
+    }
+    size_t size = (size_t)width * height * 4;
+    f.pixels.resize(size);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, s.pbo);
+    const void *mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT);
+    if (mapped) memcpy(f.pixels.data(), mapped, size);
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    s.frame = -1;
+
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        queue.push_back(std::move(f));
+    }
+    queueCond.notify_all();
+}
+
+void Exporter::writerLoop() {
+    profileThreadName("export writer");
+    std::vector<unsigned char> scratch;
+    for (;;) {
+        Frame f;
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            queueCond.wait(lock, [this] { return finishing || !queue.empty(); });
+            if (queue.empty()) break;
+            f = std::move(queue.front());
+            queue.pop_front();
+        }
+        //room in the queue again
+        queueCond.notify_all();
+
+        if (!failed) {
+            PROFILE_ZONE("export write");
+            if (writeFrame(f, scratch)) written++;
+            else failed = true;
+        }
+        std::lock_guard<std::mutex> lock(queueMutex);
+        spare.push_back(std::move(f.pixels));
+    }
+}
+
+bool Exporter::writeFrame(const Frame &f, std::vector<unsigned char> &scratch) {
+    if (format == Y4M) {
+        if (writeY4MFrame(stream, f.pixels.data(), width, height, scratch)) return true;
+        printf("Export: writing frame %ld failed\n", f.index);
+        return false;
+    }
+    toRGB(f.pixels.data(), width, height, scratch);
+    if (format == RAW) {
+        if (fwrite(scratch.data(), 1, scratch.size(), stream) == scratch.size()) return true;
+        printf("Export: writing frame %ld failed\n", f.index);
+        return false;
+    }
+
+    char name[1024];
+    snprintf(name, sizeof(name), path.c_str(), (int)f.index);
+    FILE *out = fopen(name, "wb");
+    bool ok = out != NULL;
+    if (ok && format == PPM) {
+        ok = fprintf(out, "P6\n%d %d\n255\n", width, height) > 0
+             && fwrite(scratch.data(), 1, scratch.size(), out) == scratch.size();
+    } else if (ok) {
+        ok = writePNG(out, scratch.data(), width, height);
+    }
+    if (out && fclose(out) != 0) ok = false;
+    if (!ok) printf("Export: can't write %s\n", name);
+    return ok;
+}
+
+bool Exporter::finish() {
+    if (!active()) return true;
+    //oldest first, so the frames reach the writer in order
+    for (long i = 0; i < EXPORT_PBO_COUNT; i++) {
+        Slot &s = slots[(captured + i) % EXPORT_PBO_COUNT];
+        if (s.frame >= 0) collect(s);
+    }
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        finishing = true;
+    }
+    queueCond.notify_all();
+    writer.join();
+
+    //the last of a video is still buffered, a full disk may only show here
+    if (stream && fclose(stream) != 0) {
+        printf("Export: closing %s failed\n", path.c_str());
+        failed = true;
+    }
+    stream = NULL;
+    for (Slot &s : slots) glDeleteBuffers(1, &s.pbo);
+    printf("Export: %ld of %ld frames written to %s, %.2fs waiting on the GPU, %.2fs on the writer\n",
+           written, captured, path.c_str(), gpuWait, writerWait);
+    path.clear();
+    return !failed && written == captured;
+}
@@ -0,0 +1,24 @@
+#include "fileutil.h"
+#include <cerrno>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#endif
+
+namespace {
+    bool make_dir(const std::string& path) {
+#ifdef _WIN32
+        int r = _mkdir(path.c_str());
+#else
+        int r = mkdir(path.c_str(), 0755);
+#endif
+        return r == 0 || errno == EEXIST;
+    }
+}
+
+bool make_dirs(const std::string& path) {
+    for (size_t i = path.find('/'); i != std::string::npos; i = path.find('/', i + 1)) {
+        if (!make_dir(path.substr(0, i))) return false;
+    }
+    return make_dir(path);
+}
@@ -0,0 +1,92 @@
+#include "frameclock.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+FrameClock::FrameClock() :
+    clockMode(WALL),
+    step(1.0 / 60.0),
+    now(0),
+    delta(0),
+    frameIndex(-1),
+    started(std::chrono::steady_clock::now())
+    {}
+
+bool FrameClock::configure(const char *spec) {
+    if (strcmp(spec, "wall") == 0) {
+        clockMode = WALL;
+    } else if (strncmp(spec, "fixed", 5) == 0 && (spec[5] == '\0' || spec[5] == ':')) {
+        clockMode = FIXED;
+        if (spec[5] == ':') {
+            char *end;
+            step = strtod(spec + 6, &end);
+            if (*end || step <= 0) {
+                printf("Bad fixed clock step: %s\n", spec + 6);
+                return false;
+            }
+        }
+    } else if (strncmp(spec, "script:", 7) == 0) {
+        //one time in seconds per frame, # starts a comment
+        std::ifstream in(spec + 7);
+        if (!in) {
+            printf("Can't read clock script %s\n", spec + 7);
+            return false;
+        }
+        script.clear();
+        std::string line;
+        while (std::getline(in, line)) {
+            line = line.substr(0, line.find('#'));
+            std::istringstream fields(line);
+            double t;
+            while (fields >> t) script.push_back(t);
+        }
+        if (script.empty()) {
+            printf("Clock script %s has no times in it\n", spec + 7);
+            return false;
+        }
+        clockMode = SCRIPT;
+    } else {
+        printf("Unknown clock %s (wall, fixed[:STEP] or script:FILE)\n", spec);
+        return false;
+    }
+    return true;
+}
+
+double FrameClock::timeAt(long frame) const {
+    if (clockMode == FIXED) {
+        //multiplied rather than summed so it doesn't drift
+        return frame * step;
+    }
+    if ((size_t)frame < script.size()) return script[frame];
+    //past the end keep going at the last step
+    double lastStep = script.size() > 1 ? script[script.size() - 1] - script[script.size() - 2] : 0.0;
+    return script.back() + (frame - (long)script.size() + 1) * lastStep;
+}
+
+void FrameClock::tick() {
+    frameIndex++;
+    double last = now;
+    switch (clockMode) {
+        case WALL:
+            now = wall();
+            break;
+        case FIXED:
+        case SCRIPT:
+            now = timeAt(frameIndex);
+            break;
+    }
+    delta = frameIndex == 0 ? 0.0 : now - last;
+}
+
+void FrameClock::seek(long frame) {
+    frameIndex = frame - 1;
+    //so the first dt is the step into frame, not all the way from 0
+    if (clockMode != WALL && frame > 0) now = timeAt(frame - 1);
+}
+
+double FrameClock::wall() const {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+}
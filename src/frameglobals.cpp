@@ -0,0 +1,31 @@
+#include "frameglobals.h"
+#include "consts.h"
+#include "glstate.h"
+
+FrameUniforms::FrameUniforms() :
+    ubo(0),
+    data()
+    {}
+
+void FrameUniforms::init() {
+    glGenBuffers(1, &ubo);
+    glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameGlobals), NULL, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    //programs point their FrameGlobals block at this binding in shader_prog::setup
+    glState.bindUniformBuffer(FRAME_GLOBALS_BINDING, ubo);
+}
+
+void FrameUniforms::update(const Camera &cam, float time, float dt, glm::vec2 resolution, long frame) {
+    data.view = cam.view;
+    data.projection = cam.projection;
+    data.viewProjection = cam.projection * cam.view;
+    data.time = time;
+    data.dt = dt;
+    data.resolution = resolution;
+    data.frame = (GLint)frame;
+
+    glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameGlobals), &data);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
@@ -0,0 +1,28 @@
+#include "frustum.h"
+#include <glm/gtc/matrix_access.hpp>
+
+Frustum::Frustum() {
+    //accepts everything until extract() is called
+    for (int i = 0; i < 6; i++) planes[i] = glm::vec4(0.f, 0.f, 0.f, 1.f);
+}
+
+//Gribb/Hartmann: each plane is the 4th row of the matrix plus or minus one of the others
+void Frustum::extract(const glm::mat4 &m) {
+    glm::vec4 row0 = glm::row(m, 0), row1 = glm::row(m, 1), row2 = glm::row(m, 2), row3 = glm::row(m, 3);
+    planes[0] = row3 + row0;    //left
+    planes[1] = row3 - row0;    //right
+    planes[2] = row3 + row1;    //bottom
+    planes[3] = row3 - row1;    //top
+    planes[4] = row3 + row2;    //near
+    planes[5] = row3 - row2;    //far
+    for (int i = 0; i < 6; i++) {
+        planes[i] /= glm::length(glm::vec3(planes[i]));
+    }
+}
+
+bool Frustum::intersects(const BoundingSphere &s) const {
+    for (int i = 0; i < 6; i++) {
+        if (glm::dot(glm::vec3(planes[i]), s.center) + planes[i].w < -s.radius) return false;
+    }
+    return true;
+}
@@ -1,121 +1,53 @@
 
 #include "geometry.h"
 #include "consts.h"
-#include <stack>
-#include <vector>
-#include <assimp/Importer.hpp>
-#include <assimp/scene.h>
-#include <assimp/postprocess.h>
+#include "renderstats.h"
+#include "glstate.h"
+#include "profiler.h"
 
 
-Geometry::Geometry(const char *objfile, const char* vshader, const char* fshader) :
-    pshader(vshader, fshader),
+Geometry::Geometry(const char *objfile, const char* vshader, const char* fshader, bool quantized) :
+    pshader(vshader, fshader, quantized ? "#define QUANTIZED" : NULL),
+    depthshader(vshader, "shaders/depth.frag.glsl", quantized ? "#define QUANTIZED" : NULL),
+    instanceshader(vshader, fshader, quantized ? "#define INSTANCED\n#define QUANTIZED" : "#define INSTANCED"),
+    instanceDepthshader(vshader, "shaders/depth.frag.glsl", quantized ? "#define INSTANCED\n#define QUANTIZED" : "#define INSTANCED"),
     position(glm::vec3(0)),
     angle(0.f),
-    VAO(1),
-    projectionMatrix(cam.projection),
-    viewMatrix(cam.view)
+    scale(1.f),
+    uniformsResolved(false),
+    depthResolved(false),
+    quantized(quantized),
+    name(objfile)
 
     {
         importMesh(objfile);
-        pshader.setup();
-        pshader.begin();
-
-        //this uniform stays constant so it doesn't have to be changed after initial setup
-        pshader.uniformMatrix4fv("projectionMatrix", projectionMatrix);
-        pshader.end();
+        pshader.submit();
+        depthshader.submit();
+        instanceshader.submit();
+        instanceDepthshader.submit();
     };
 
+//shared through the registry, only the first Geometry of a file imports and uploads it
 void Geometry::importMesh(const char *objfile) {
-    Assimp::Importer importer;
-
-    const aiScene *scene = importer.ReadFile(objfile,
-        aiProcess_CalcTangentSpace       |
-        aiProcess_Triangulate            |
-        aiProcess_JoinIdenticalVertices  |
-        aiProcess_SortByPType);
+    mesh = registryMesh(objfile, quantized);
+}
 
-    if (!scene){
-        printf("Error importing a file: %s\n", importer.GetErrorString());
+//true once the program has finished compiling in the background
+bool Geometry::ready() {
+    if (!uniformsResolved && pshader.poll()) {
+        modelLoc = pshader.handle("modelMatrix");
+        uniformsResolved = true;
     }
+    return uniformsResolved;
+}
 
-    printf("Loaded mesh: %s \n", scene->mMeshes[0][0].mName.C_Str());
-
-    aiMesh *imported = scene->mMeshes[0];
-    printf("number of vertices: %d, number of faces: %d\n", imported->mNumVertices, imported->mNumFaces);
-    numFaces = imported->mNumFaces;
-
-
-    ////////////////////////////////////
-
-    std::vector<GLfloat> vertexdata;
-    vertexdata.reserve(imported->mNumVertices * 5);
-    std::vector<GLuint> indices;
-
-    for (unsigned int i = 0; i < imported->mNumVertices; i++) {
-        vertexdata.push_back(imported->mVertices[i].x);
-        vertexdata.push_back(imported->mVertices[i].y);
-        vertexdata.push_back(imported->mVertices[i].z);
-        vertexdata.push_back(imported->mTextureCoords[0][i].x);
-        vertexdata.push_back(imported->mTextureCoords[0][i].y);
-        vertexdata.push_back(imported->mNormals[i].x);
-        vertexdata.push_back(imported->mNormals[i].y);
-        vertexdata.push_back(imported->mNormals[i].z);
-
-    }
-    // we know its triangles
-    for (unsigned int i = 0; i < imported->mNumFaces; i++) {
-        for (unsigned int j = 0; j < imported->mFaces[i].mNumIndices; j++){
-            indices.push_back((GLuint)imported->mFaces[i].mIndices[j]);
-        }
-    }
+//the instanced program has no uniforms of its own to resolve
+bool Geometry::instanceable() {
+    return instanceshader.poll();
+}
 
-    GLuint vertexArrayHandle;
-    glGenVertexArrays(1, &vertexArrayHandle);
-    glBindVertexArray(vertexArrayHandle);
-
-    GLuint vboHandle;
-    glGenBuffers(1, &vboHandle);
-    glBindBuffer(GL_ARRAY_BUFFER, vboHandle);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat)*vertexdata.size(), &vertexdata[0], GL_STATIC_DRAW);
-
-    glEnableVertexAttribArray(VERTEX_POSITION_LOC);
-    //indexes are defined inside the vertex shader itself with layout specification
-    glVertexAttribPointer(
-        VERTEX_POSITION_LOC,
-        3,
-        GL_FLOAT,
-        GL_FALSE,
-        8*sizeof(GLfloat),
-        (const GLvoid*)(0*sizeof(GLfloat))
-    );
-
-    //vx, vy, vz, u, v, nx, ny, nz
-    glEnableVertexAttribArray(NORMAL_LOC);
-    glVertexAttribPointer(
-        NORMAL_LOC,
-        3,                 // number of elements per vertex, here
-        GL_FLOAT,          // the type of each element
-        GL_FALSE,          // take our values as-is
-        8*sizeof(GLfloat), // stride
-        (const GLvoid*)(5*sizeof(GLfloat))                  // offset of first element
-    );
-
-    glEnableVertexAttribArray(UV_LOC);
-    glVertexAttribPointer(
-        UV_LOC,
-        2,
-        GL_FLOAT,
-        GL_FALSE,
-        8*sizeof(GLfloat),
-        (const GLvoid*)(3*sizeof(GLfloat))
-    );
-
-    glGenBuffers(1, &vboHandle);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vboHandle);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLfloat)*indices.size(), &indices[0], GL_STATIC_DRAW);
-
-    VAO = vertexArrayHandle;
+GLuint Geometry::instancedProgram() {
+    return instanceshader;
 }
 
 void Geometry::setScale(float scalein) {
@@ -128,28 +60,68 @@ void Geometry::setPos(glm::vec3 positionin) {
     position = positionin;
 }
 
-void Geometry::render() {
-    std::stack<glm::mat4> ms;
-    ms.push(glm::mat4(1.0));
+glm::mat4 Geometry::modelMatrix() const {
+    glm::mat4 model = glm::translate(glm::mat4(1.0), position);
+    model = glm::rotate(model, glm::radians(angle), glm::vec3(0., 1., 0.));
+    model = glm::rotate(model, glm::radians(-90.f), glm::vec3(1., 0., 0.));
+    return glm::scale(model, glm::vec3(scale));
+}
+
+glm::mat4 Geometry::instanceMatrix() const {
+    return modelMatrix() * mesh->decodeMatrix;
+}
 
+//world space version of the mesh bounds (scale is uniform, so the radius just scales along)
+BoundingSphere Geometry::bounds() const {
+    return BoundingSphere{glm::vec3(modelMatrix() * glm::vec4(mesh->bounds.center, 1.f)), mesh->bounds.radius * scale};
+}
+
+void Geometry::render() {
     //set up the shaders, uniforms
     //rendering is as usual, but beginning and ending their own shaders, as well as updating necessary uniforms
     pshader.begin();
-    pshader.uniformMatrix4fv("viewMatrix", viewMatrix);
-    glUniform1f(TIME_LOC, (float)glfwGetTime());
-
-    ms.push(ms.top());
-        ms.top() = glm::translate(ms.top(), position);
-        ms.top() = glm::rotate(ms.top(), glm::radians(angle), glm::vec3(0., 1., 0.));
-        ms.top() = glm::rotate(ms.top(), glm::radians(-90.f), glm::vec3(1., 0., 0.));
-        ms.top() = glm::scale(ms.top(), glm::vec3(scale));
-        //maybe we can even set up the modelMatrix only once in constructor as well if they don't move around
-        pshader.uniformMatrix4fv("modelMatrix", ms.top());
-        glDisable(GL_CULL_FACE);
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, numFaces * 3, GL_UNSIGNED_INT, 0);
-        glEnable(GL_CULL_FACE);
-    ms.pop();
+    pshader.uniformMatrix4fv(modelLoc, instanceMatrix());
+    //the dome is seen from inside and out
+    glState.enable(GL_CULL_FACE, false);
+    glState.bindVertexArray(mesh->VAO);
+    glDrawElements(GL_TRIANGLES, mesh->numIndices, mesh->indexType, 0);
+    renderStats.drawCalls++;
     pshader.end();
 };
 
+//depth only, skipped until its program is in (render() then writes the depth itself)
+void Geometry::renderDepth() {
+    if (!depthResolved) {
+        if (!depthshader.poll()) return;
+        depthModelLoc = depthshader.handle("modelMatrix");
+        depthResolved = true;
+    }
+    depthshader.begin();
+    depthshader.uniformMatrix4fv(depthModelLoc, instanceMatrix());
+    glState.enable(GL_CULL_FACE, false);
+    glState.bindVertexArray(mesh->VAO);
+    glDrawElements(GL_TRIANGLES, mesh->numIndices, mesh->indexType, 0);
+    renderStats.drawCalls++;
+    depthshader.end();
+}
+
+void Geometry::renderInstanced(GLuint instanceVBO, size_t start, GLsizei count) {
+    instanceshader.begin();
+    glState.enable(GL_CULL_FACE, false);
+    glState.bindVertexArray(mesh->VAO);
+    mesh->pointInstances(instanceVBO, start);
+    glDrawElementsInstanced(GL_TRIANGLES, mesh->numIndices, mesh->indexType, 0, count);
+    renderStats.drawCalls++;
+    instanceshader.end();
+}
+
+void Geometry::renderDepthInstanced(GLuint instanceVBO, size_t start, GLsizei count) {
+    if (!instanceDepthshader.poll()) return;
+    instanceDepthshader.begin();
+    glState.enable(GL_CULL_FACE, false);
+    glState.bindVertexArray(mesh->VAO);
+    mesh->pointInstances(instanceVBO, start);
+    glDrawElementsInstanced(GL_TRIANGLES, mesh->numIndices, mesh->indexType, 0, count);
+    renderStats.drawCalls++;
+    instanceDepthshader.end();
+}
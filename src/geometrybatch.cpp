@@ -0,0 +1,64 @@
+#include "geometrybatch.h"
+#include "renderqueue.h"
+#include <algorithm>
+
+GeometryBatch::GeometryBatch() :
+    instanceVBO(0),
+    capacity(0)
+    {}
+
+void GeometryBatch::init() {
+    glGenBuffers(1, &instanceVBO);
+}
+
+void GeometryBatch::clear() {
+    queued.clear();
+}
+
+void GeometryBatch::add(Geometry *g) {
+    queued.push_back(Queued{g, 0.f});
+}
+
+void GeometryBatch::build(const glm::mat4 &view) {
+    instances.clear();
+    groups.clear();
+    if (queued.empty()) return;
+
+    //group by program and mesh, nearest first inside a group
+    for (Queued &q : queued) {
+        q.depth = viewDepth(view, q.geometry->bounds().center);
+    }
+    std::sort(queued.begin(), queued.end(), [](const Queued &a, const Queued &b) {
+        GLuint pa = a.geometry->instancedProgram(), pb = b.geometry->instancedProgram();
+        if (pa != pb) return pa < pb;
+        if (a.geometry->gpuMesh() != b.geometry->gpuMesh()) return a.geometry->gpuMesh() < b.geometry->gpuMesh();
+        return a.depth < b.depth;
+    });
+    for (const Queued &q : queued) {
+        GLuint program = q.geometry->instancedProgram();
+        if (groups.empty() || groups.back().program != program || groups.back().first->gpuMesh() != q.geometry->gpuMesh()) {
+            groups.push_back(Group{q.geometry, program, instances.size(), 0, q.depth});
+        }
+        groups.back().count++;
+        instances.push_back(q.geometry->instanceMatrix());
+    }
+
+    //orphan and refill the whole instance buffer once per frame
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    if (instances.size() > capacity) {
+        capacity = std::max(instances.size(), capacity * 2);
+    }
+    glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(glm::mat4), NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, instances.size() * sizeof(glm::mat4), &instances[0]);
+}
+
+void GeometryBatch::drawGroup(size_t i) {
+    const Group &g = groups[i];
+    g.first->renderInstanced(instanceVBO, g.start, g.count);
+}
+
+//nothing until the group's depth program has compiled
+void GeometryBatch::drawGroupDepth(size_t i) {
+    const Group &g = groups[i];
+    g.first->renderDepthInstanced(instanceVBO, g.start, g.count);
+}
@@ -0,0 +1,326 @@
+#include "gldispatch.h"
+#include <map>
+#include <unordered_map>
+#include <vector>
+#include <cstring>
+
+//from here on the names mean GL again, GLEW's entry points are called through their pointers
+#undef glUseProgram
+#undef glBindVertexArray
+#undef glBindBuffer
+#undef glBindBufferBase
+#undef glActiveTexture
+#undef glBindTexture
+#undef glBindFramebuffer
+#undef glEnable
+#undef glDisable
+#undef glDepthFunc
+#undef glColorMask
+#undef glCullFace
+#undef glViewport
+#undef glUniform1i
+#undef glUniform1f
+#undef glUniform3f
+#undef glUniform4f
+#undef glUniformMatrix4fv
+#undef glVertexAttrib4fv
+#undef glVertexAttribPointer
+#undef glBufferData
+#undef glBufferSubData
+#undef glTexImage2D
+#undef glDrawElements
+#undef glDrawElementsInstanced
+#undef glDrawArrays
+#undef glClear
+
+namespace {
+    const int64_t UNKNOWN = -1;
+
+    GLDispatchStats frame, last, totals;
+    long frames = 0;
+
+    //what we believe is bound/set right now, UNKNOWN (or missing) until we see it set
+    struct Shadow {
+        int64_t program, vao, activeTexture, drawFramebuffer, depthFunc, cullFace, colorMask;
+        GLint viewport[4];
+        bool viewportKnown;
+        std::map<GLenum, int64_t> buffers;
+        std::map<std::pair<GLenum, GLuint>, int64_t> bufferBases;
+        std::map<std::pair<int64_t, GLenum>, int64_t> textures;    //(texture unit, target)
+        std::map<GLenum, int64_t> caps;
+        std::unordered_map<uint64_t, std::vector<GLfloat>> uniforms;  //program << 32 | location
+        std::map<GLuint, std::vector<GLfloat>> attribs;
+    } shadow;
+
+    void reset() {
+        shadow = Shadow();
+        shadow.program = shadow.vao = shadow.activeTexture = shadow.drawFramebuffer = UNKNOWN;
+        shadow.depthFunc = shadow.cullFace = shadow.colorMask = UNKNOWN;
+        shadow.viewportKnown = false;
+    }
+
+    struct Init { Init() { reset(); } } init;
+
+    //counts the call, true if it actually changes something
+    bool change(GLDispatchKind kind, int64_t &current, int64_t value) {
+        frame.calls[kind]++;
+        if (current == value) {
+            frame.redundant[kind]++;
+            return false;
+        }
+        current = value;
+        return true;
+    }
+
+    int64_t &known(std::map<GLenum, int64_t> &m, GLenum key) {
+        return m.insert(std::make_pair(key, UNKNOWN)).first->second;
+    }
+
+    //a uniform set to what the program already holds, or to location -1 which GL ignores
+    void uniform(GLint location, const GLfloat *values, size_t n) {
+        frame.calls[GLD_UNIFORM]++;
+        frame.bytes += n * sizeof(GLfloat);
+        if (location < 0) {
+            frame.redundant[GLD_UNIFORM]++;
+            return;
+        }
+        if (shadow.program == UNKNOWN) return;
+        std::vector<GLfloat> &current = shadow.uniforms[(uint64_t)shadow.program << 32 | (uint32_t)location];
+        if (current.size() == n && memcmp(&current[0], values, n * sizeof(GLfloat)) == 0) {
+            frame.redundant[GLD_UNIFORM]++;
+            return;
+        }
+        current.assign(values, values + n);
+    }
+
+    size_t pixelSize(GLenum format, GLenum type) {
+        size_t channels = format == GL_RED ? 1 : format == GL_RG ? 2 : format == GL_RGB ? 3 : 4;
+        size_t bytes = (type == GL_FLOAT || type == GL_INT || type == GL_UNSIGNED_INT) ? 4 :
+                       (type == GL_HALF_FLOAT || type == GL_SHORT || type == GL_UNSIGNED_SHORT) ? 2 : 1;
+        return channels * bytes;
+    }
+
+    void add(GLDispatchStats &to, const GLDispatchStats &from) {
+        for (int i = 0; i < GLD_KIND_COUNT; i++) {
+            to.calls[i] += from.calls[i];
+            to.redundant[i] += from.redundant[i];
+        }
+        to.bytes += from.bytes;
+    }
+}
+
+uint64_t GLDispatchStats::totalCalls() const {
+    uint64_t n = 0;
+    for (int i = 0; i < GLD_KIND_COUNT; i++) n += calls[i];
+    return n;
+}
+
+uint64_t GLDispatchStats::totalRedundant() const {
+    uint64_t n = 0;
+    for (int i = 0; i < GLD_KIND_COUNT; i++) n += redundant[i];
+    return n;
+}
+
+const char *glDispatchKindName(int kind) {
+    static const char *names[GLD_KIND_COUNT] = {
+        "program", "vertex array", "buffer bind", "texture bind", "framebuffer", "enable/disable",
+        "fixed state", "uniform", "vertex attribute", "upload", "draw", "clear"
+    };
+    return kind >= 0 && kind < GLD_KIND_COUNT ? names[kind] : "?";
+}
+
+bool glDispatchEnabled() {
+#ifdef GL_STATS
+    return true;
+#else
+    return false;
+#endif
+}
+
+void glDispatchEndFrame() {
+    last = frame;
+    add(totals, frame);
+    frames++;
+    frame = GLDispatchStats();
+}
+
+const GLDispatchStats &glDispatchLastFrame() {
+    return last;
+}
+
+void glDispatchPrintAverages(FILE *out) {
+    if (frames == 0) return;
+    fprintf(out, "GL calls per frame over %ld frames:\n", frames);
+    fprintf(out, "  %-18s %10s %10s\n", "kind", "calls", "redundant");
+    for (int i = 0; i < GLD_KIND_COUNT; i++) {
+        if (totals.calls[i] == 0) continue;
+        fprintf(out, "  %-18s %10.1f %10.1f\n", glDispatchKindName(i),
+                (double)totals.calls[i] / frames, (double)totals.redundant[i] / frames);
+    }
+    fprintf(out, "  %-18s %10.1f %10.1f\n", "total", (double)totals.totalCalls() / frames, (double)totals.totalRedundant() / frames);
+    fprintf(out, "  %.1f KB uploaded per frame\n", totals.bytes / 1024.0 / frames);
+}
+
+void glDispatchInvalidate() {
+    reset();
+}
+
+void GLAPIENTRY gldUseProgram(GLuint program) {
+    change(GLD_PROGRAM, shadow.program, program);
+    __glewUseProgram(program);
+}
+
+void GLAPIENTRY gldBindVertexArray(GLuint array) {
+    //the element array binding is part of the vertex array
+    if (change(GLD_VERTEX_ARRAY, shadow.vao, array)) shadow.buffers.erase(GL_ELEMENT_ARRAY_BUFFER);
+    __glewBindVertexArray(array);
+}
+
+void GLAPIENTRY gldBindBuffer(GLenum target, GLuint buffer) {
+    change(GLD_BUFFER, known(shadow.buffers, target), buffer);
+    __glewBindBuffer(target, buffer);
+}
+
+void GLAPIENTRY gldBindBufferBase(GLenum target, GLuint index, GLuint buffer) {
+    int64_t &base = shadow.bufferBases.insert(std::make_pair(std::make_pair(target, index), UNKNOWN)).first->second;
+    change(GLD_BUFFER, base, buffer);
+    //binds the generic point as well
+    known(shadow.buffers, target) = buffer;
+    __glewBindBufferBase(target, index, buffer);
+}
+
+void GLAPIENTRY gldActiveTexture(GLenum texture) {
+    change(GLD_TEXTURE, shadow.activeTexture, texture);
+    __glewActiveTexture(texture);
+}
+
+void GLAPIENTRY gldBindTexture(GLenum target, GLuint texture) {
+    int64_t &bound = shadow.textures.insert(std::make_pair(std::make_pair(shadow.activeTexture, target), UNKNOWN)).first->second;
+    change(GLD_TEXTURE, bound, texture);
+    //an unknown unit could be any of them
+    if (shadow.activeTexture == UNKNOWN) bound = UNKNOWN;
+    glBindTexture(target, texture);
+}
+
+void GLAPIENTRY gldBindFramebuffer(GLenum target, GLuint framebuffer) {
+    if (target == GL_READ_FRAMEBUFFER) frame.calls[GLD_FRAMEBUFFER]++;
+    else change(GLD_FRAMEBUFFER, shadow.drawFramebuffer, framebuffer);
+    __glewBindFramebuffer(target, framebuffer);
+}
+
+void GLAPIENTRY gldEnable(GLenum cap) {
+    change(GLD_CAPABILITY, known(shadow.caps, cap), 1);
+    glEnable(cap);
+}
+
+void GLAPIENTRY gldDisable(GLenum cap) {
+    change(GLD_CAPABILITY, known(shadow.caps, cap), 0);
+    glDisable(cap);
+}
+
+void GLAPIENTRY gldDepthFunc(GLenum func) {
+    change(GLD_FIXED_STATE, shadow.depthFunc, func);
+    glDepthFunc(func);
+}
+
+void GLAPIENTRY gldColorMask(GLboolean r, GLboolean g, GLboolean b, GLboolean a) {
+    change(GLD_FIXED_STATE, shadow.colorMask, (r ? 1 : 0) | (g ? 2 : 0) | (b ? 4 : 0) | (a ? 8 : 0));
+    glColorMask(r, g, b, a);
+}
+
+void GLAPIENTRY gldCullFace(GLenum mode) {
+    change(GLD_FIXED_STATE, shadow.cullFace, mode);
+    glCullFace(mode);
+}
+
+void GLAPIENTRY gldViewport(GLint x, GLint y, GLsizei width, GLsizei height) {
+    frame.calls[GLD_FIXED_STATE]++;
+    GLint v[4] = {x, y, width, height};
+    if (shadow.viewportKnown && memcmp(v, shadow.viewport, sizeof(v)) == 0) frame.redundant[GLD_FIXED_STATE]++;
+    memcpy(shadow.viewport, v, sizeof(v));
+    shadow.viewportKnown = true;
+    glViewport(x, y, width, height);
+}
+
+void GLAPIENTRY gldUniform1i(GLint location, GLint v0) {
+    //compared as bits, only equality matters
+    GLfloat f;
+    memcpy(&f, &v0, sizeof(f));
+    uniform(location, &f, 1);
+    __glewUniform1i(location, v0);
+}
+
+void GLAPIENTRY gldUniform1f(GLint location, GLfloat v0) {
+    uniform(location, &v0, 1);
+    __glewUniform1f(location, v0);
+}
+
+void GLAPIENTRY gldUniform3f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2) {
+    GLfloat v[3] = {v0, v1, v2};
+    uniform(location, v, 3);
+    __glewUniform3f(location, v0, v1, v2);
+}
+
+void GLAPIENTRY gldUniform4f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3) {
+    GLfloat v[4] = {v0, v1, v2, v3};
+    uniform(location, v, 4);
+    __glewUniform4f(location, v0, v1, v2, v3);
+}
+
+void GLAPIENTRY gldUniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat *value) {
+    uniform(location, value, 16 * count);
+    __glewUniformMatrix4fv(location, count, transpose, value);
+}
+
+void GLAPIENTRY gldVertexAttrib4fv(GLuint index, const GLfloat *v) {
+    frame.calls[GLD_ATTRIBUTE]++;
+    frame.bytes += 4 * sizeof(GLfloat);
+    std::vector<GLfloat> &current = shadow.attribs[index];
+    if (current.size() == 4 && memcmp(&current[0], v, 4 * sizeof(GLfloat)) == 0) frame.redundant[GLD_ATTRIBUTE]++;
+    else current.assign(v, v + 4);
+    __glewVertexAttrib4fv(index, v);
+}
+
+void GLAPIENTRY gldVertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const GLvoid *pointer) {
+    frame.calls[GLD_ATTRIBUTE]++;
+    __glewVertexAttribPointer(index, size, type, normalized, stride, pointer);
+}
+
+void GLAPIENTRY gldBufferData(GLenum target, GLsizeiptr size, const GLvoid *data, GLenum usage) {
+    frame.calls[GLD_UPLOAD]++;
+    //NULL only (re)allocates
+    if (data) frame.bytes += size;
+    __glewBufferData(target, size, data, usage);
+}
+
+void GLAPIENTRY gldBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const GLvoid *data) {
+    frame.calls[GLD_UPLOAD]++;
+    frame.bytes += size;
+    __glewBufferSubData(target, offset, size, data);
+}
+
+void GLAPIENTRY gldTexImage2D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const GLvoid *pixels) {
+    frame.calls[GLD_UPLOAD]++;
+    if (pixels) frame.bytes += (uint64_t)width * height * pixelSize(format, type);
+    glTexImage2D(target, level, internalformat, width, height, border, format, type, pixels);
+}
+
+void GLAPIENTRY gldDrawElements(GLenum mode, GLsizei count, GLenum type, const GLvoid *indices) {
+    frame.calls[GLD_DRAW]++;
+    glDrawElements(mode, count, type, indices);
+}
+
+void GLAPIENTRY gldDrawElementsInstanced(GLenum mode, GLsizei count, GLenum type, const GLvoid *indices, GLsizei primcount) {
+    frame.calls[GLD_DRAW]++;
+    __glewDrawElementsInstanced(mode, count, type, indices, primcount);
+}
+
+void GLAPIENTRY gldDrawArrays(GLenum mode, GLint first, GLsizei count) {
+    frame.calls[GLD_DRAW]++;
+    glDrawArrays(mode, first, count);
+}
+
+void GLAPIENTRY gldClear(GLbitfield mask) {
+    frame.calls[GLD_CLEAR]++;
+    glClear(mask);
+}
@@ -1,4 +1,10 @@
 #include "globals.h"
+#include "renderstats.h"
 
 Camera cam;
+bool cachePaintings = false;
+bool depthPrepass = true;
+bool gpuProfile = false;
+bool dumpGpuProfile = false;
+RenderStats renderStats;
 std::map<int, bool> keyboard = std::map<int, bool>();
@@ -0,0 +1,86 @@
+#include "glstate.h"
+#include "renderstats.h"
+
+GLState glState;
+
+GLState::GLState() {
+    invalidate();
+}
+
+void GLState::invalidate() {
+    curProgram = curVao = activeUnit = curDepthFunc = curDepthMask = curColorMask = -1;
+    for (GLint &t : textures) t = -1;
+    for (GLint &b : uniformBuffers) b = -1;
+    caps.clear();
+}
+
+void GLState::useProgram(GLuint p) {
+    if (curProgram == (GLint)p) return;
+    curProgram = p;
+    glUseProgram(p);
+    renderStats.programBinds++;
+}
+
+void GLState::bindVertexArray(GLuint v) {
+    if (curVao == (GLint)v) return;
+    curVao = v;
+    glBindVertexArray(v);
+}
+
+void GLState::enable(GLenum cap, bool on) {
+    Cap *c = NULL;
+    for (Cap &k : caps) {
+        if (k.cap == cap) c = &k;
+    }
+    if (!c) {
+        caps.push_back(Cap{cap, -1});
+        c = &caps.back();
+    }
+    if (c->on == (int)on) return;
+    c->on = on;
+    if (on) glEnable(cap);
+    else glDisable(cap);
+}
+
+void GLState::depthFunc(GLenum func) {
+    if (curDepthFunc == (GLint)func) return;
+    curDepthFunc = func;
+    glDepthFunc(func);
+}
+
+void GLState::depthMask(bool write) {
+    if (curDepthMask == (GLint)write) return;
+    curDepthMask = write;
+    glDepthMask(write ? GL_TRUE : GL_FALSE);
+}
+
+void GLState::colorMask(bool write) {
+    if (curColorMask == (GLint)write) return;
+    curColorMask = write;
+    GLboolean b = write ? GL_TRUE : GL_FALSE;
+    glColorMask(b, b, b, b);
+}
+
+void GLState::bindTexture(int unit, GLuint texture) {
+    if (unit >= GLSTATE_TEXTURE_UNITS) {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        activeUnit = unit;
+        return;
+    }
+    if (textures[unit] == (GLint)texture) return;
+    if (activeUnit != unit) {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        activeUnit = unit;
+    }
+    textures[unit] = texture;
+    glBindTexture(GL_TEXTURE_2D, texture);
+}
+
+void GLState::bindUniformBuffer(GLuint index, GLuint buffer) {
+    if (index < GLSTATE_UNIFORM_BINDINGS) {
+        if (uniformBuffers[index] == (GLint)buffer) return;
+        uniformBuffers[index] = buffer;
+    }
+    glBindBufferBase(GL_UNIFORM_BUFFER, index, buffer);
+}
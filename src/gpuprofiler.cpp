@@ -0,0 +1,172 @@
+#include "gpuprofiler.h"
+#include "glstate.h"
+#include <algorithm>
+
+double GpuSection::mean() const {
+    if (samples == 0) return 0;
+    double sum = 0;
+    for (int i = 0; i < samples; i++) sum += history[i];
+    return sum / samples;
+}
+
+double GpuSection::max() const {
+    double m = 0;
+    for (int i = 0; i < samples; i++) m = std::max(m, history[i]);
+    return m;
+}
+
+double GpuSection::last() const {
+    if (samples == 0) return 0;
+    return history[(next + GPU_PROFILER_HISTORY - 1) % GPU_PROFILER_HISTORY];
+}
+
+GpuProfiler::GpuProfiler() :
+    frameIndex(-1),
+    open(-1),
+    dropped(0),
+    overlayshader("shaders/overlay.vert.glsl", "shaders/overlay.frag.glsl"),
+    overlayVAO(0),
+    overlayVBO(0),
+    enabled(false)
+    {}
+
+void GpuProfiler::init() {
+    overlayshader.submit();
+
+    //x, y in pixels from the top left, r, g, b
+    glGenVertexArrays(1, &overlayVAO);
+    glState.bindVertexArray(overlayVAO);
+    glGenBuffers(1, &overlayVBO);
+    glBindBuffer(GL_ARRAY_BUFFER, overlayVBO);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 5*sizeof(float), (const GLvoid*)0);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 5*sizeof(float), (const GLvoid*)(2*sizeof(float)));
+}
+
+void GpuProfiler::collect(int slot) {
+    std::vector<Pending> &results = pending[slot];
+    if (results.empty()) return;
+
+    //all or nothing: asking for an unfinished result would stall
+    for (const Pending &p : results) {
+        GLint available = 0;
+        glGetQueryObjectiv(p.query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) {
+            dropped++;
+            results.clear();
+            return;
+        }
+    }
+
+    std::map<int, double> frame;
+    for (const Pending &p : results) {
+        GLuint64 ns;
+        glGetQueryObjectui64v(p.query, GL_QUERY_RESULT, &ns);
+        frame[p.section] += ns / 1e6;
+    }
+    for (const auto &f : frame) {
+        GpuSection &s = sections[f.first];
+        s.history[s.next] = f.second;
+        s.next = (s.next + 1) % GPU_PROFILER_HISTORY;
+        s.samples = std::min(s.samples + 1, GPU_PROFILER_HISTORY);
+    }
+    results.clear();
+}
+
+void GpuProfiler::beginFrame() {
+    frameIndex++;
+    collect(frameIndex % GPU_PROFILER_FRAMES);
+}
+
+void GpuProfiler::begin(const char *label) {
+    if (frameIndex < 0) return;     //no beginFrame yet
+    if (open >= 0) end();
+    auto it = ids.find(label);
+    if (it == ids.end()) {
+        GpuSection s;
+        s.label = label;
+        s.samples = 0;
+        s.next = 0;
+        //something stable and recognisable per label
+        unsigned h = 2166136261u;
+        for (const char *c = label; *c; c++) h = (h ^ (unsigned char)*c) * 16777619u;
+        s.color = glm::vec3(0.35f) + 0.65f * glm::vec3((h & 0xff) / 255.f, ((h >> 8) & 0xff) / 255.f, ((h >> 16) & 0xff) / 255.f);
+        it = ids.insert(std::make_pair(std::string(label), (int)sections.size())).first;
+        sections.push_back(s);
+    }
+    open = it->second;
+
+    int slot = frameIndex % GPU_PROFILER_FRAMES;
+    std::vector<GLuint> &queries = pool[slot];
+    if (pending[slot].size() == queries.size()) {
+        GLuint q;
+        glGenQueries(1, &q);
+        queries.push_back(q);
+    }
+    GLuint q = queries[pending[slot].size()];
+    pending[slot].push_back(Pending{open, q});
+    glBeginQuery(GL_TIME_ELAPSED, q);
+}
+
+void GpuProfiler::end() {
+    if (open < 0) return;
+    glEndQuery(GL_TIME_ELAPSED);
+    open = -1;
+}
+
+void GpuProfiler::dump(FILE *out) const {
+    std::vector<const GpuSection*> order;
+    for (const GpuSection &s : sections) order.push_back(&s);
+    std::stable_sort(order.begin(), order.end(), [](const GpuSection *a, const GpuSection *b) {
+        return a->mean() > b->mean();
+    });
+    double total = 0;
+    for (const GpuSection *s : order) total += s->mean();
+    fprintf(out, "GPU cost over the last %d frames (%ld dropped):\n", GPU_PROFILER_HISTORY, dropped);
+    fprintf(out, "  %-4s %-36s %9s %9s %9s %6s\n", "rank", "section", "mean ms", "max ms", "last ms", "share");
+    for (size_t i = 0; i < order.size(); i++) {
+        const GpuSection *s = order[i];
+        fprintf(out, "  %-4zu %-36s %9.3f %9.3f %9.3f %5.1f%%\n", i + 1, s->label.c_str(),
+                s->mean(), s->max(), s->last(), total > 0 ? 100.0 * s->mean() / total : 0.0);
+    }
+}
+
+void GpuProfiler::drawOverlay() {
+    if (sections.empty() || !overlayshader.poll()) return;
+
+    std::vector<const GpuSection*> order;
+    for (const GpuSection &s : sections) order.push_back(&s);
+    std::stable_sort(order.begin(), order.end(), [](const GpuSection *a, const GpuSection *b) {
+        return a->mean() > b->mean();
+    });
+
+    //one bar per section, the most expensive one spans the whole width; a thin tick marks its max
+    const float left = 20.f, top = 20.f, width = 300.f, height = 10.f, gap = 4.f;
+    double scale = std::max(order[0]->mean(), 1e-3);
+    std::vector<float> verts;
+    auto rect = [&](float x0, float y0, float x1, float y1, glm::vec3 c) {
+        float corners[6][2] = {{x0, y0}, {x1, y0}, {x1, y1}, {x0, y0}, {x1, y1}, {x0, y1}};
+        for (auto &v : corners) {
+            verts.insert(verts.end(), {v[0], v[1], c.r, c.g, c.b});
+        }
+    };
+    rect(left - gap, top - gap, left + width + gap, top + order.size() * (height + gap), glm::vec3(0.05f));
+    for (size_t i = 0; i < order.size(); i++) {
+        float y = top + i * (height + gap);
+        float w = (float)(order[i]->mean() / scale) * width;
+        float m = std::min((float)(order[i]->max() / scale) * width, width);
+        rect(left, y, left + w, y + height, order[i]->color);
+        rect(left + m - 1.f, y, left + m + 1.f, y + height, glm::vec3(1.f));
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, overlayVBO);
+    glBufferData(GL_ARRAY_BUFFER, verts.size() * sizeof(float), &verts[0], GL_STREAM_DRAW);
+    //main turns the depth test back on at the start of the next frame
+    glState.enable(GL_DEPTH_TEST, false);
+    glState.enable(GL_CULL_FACE, false);
+    overlayshader.begin();
+    glState.bindVertexArray(overlayVAO);
+    glDrawArrays(GL_TRIANGLES, 0, verts.size() / 5);
+    overlayshader.end();
+}
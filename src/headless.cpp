@@ -0,0 +1,146 @@
+#include "headless.h"
+#include <cstdio>
+#include <cstring>
+#ifndef _WIN32
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+HeadlessContext::HeadlessContext() :
+    display(NULL),
+    context(NULL),
+    fbo(0),
+    colorRB(0),
+    depthRB(0),
+    width(0),
+    height(0)
+    {}
+
+#ifdef _WIN32
+
+bool HeadlessContext::init() {
+    printf("Headless mode needs EGL, which isn't available on this platform\n");
+    return false;
+}
+
+HeadlessContext::Proc HeadlessContext::procAddress(const char *) {
+    return NULL;
+}
+
+#else
+
+HeadlessContext::Proc HeadlessContext::procAddress(const char *name) {
+    return (Proc)eglGetProcAddress(name);
+}
+
+bool HeadlessContext::init() {
+    //prefer the surfaceless platform, it needs neither X nor a GPU device node
+    EGLDisplay dpy = EGL_NO_DISPLAY;
+    const char *clientExts = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+            (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (getPlatformDisplay && clientExts && strstr(clientExts, "EGL_MESA_platform_surfaceless")) {
+        dpy = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+    }
+    if (dpy == EGL_NO_DISPLAY) dpy = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+    EGLint major, minor;
+    if (dpy == EGL_NO_DISPLAY || !eglInitialize(dpy, &major, &minor)) {
+        printf("Headless: could not initialize an EGL display (0x%x)\n", eglGetError());
+        return false;
+    }
+    display = dpy;
+    const char *exts = eglQueryString(dpy, EGL_EXTENSIONS);
+    if (!exts || !strstr(exts, "EGL_KHR_surfaceless_context") || !strstr(exts, "EGL_KHR_create_context")) {
+        printf("Headless: EGL %d.%d lacks surfaceless or versioned contexts\n", major, minor);
+        return false;
+    }
+    if (!eglBindAPI(EGL_OPENGL_API)) {
+        printf("Headless: EGL can't do desktop OpenGL\n");
+        return false;
+    }
+
+    //we never make a surface, so any GL capable config will do (or none at all if allowed)
+    const EGLint configAttribs[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_NONE
+    };
+    EGLConfig config = (EGLConfig)0;
+    EGLint numConfigs = 0;
+    if (!eglChooseConfig(dpy, configAttribs, &config, 1, &numConfigs) || numConfigs == 0) {
+        if (!strstr(exts, "EGL_KHR_no_config_context")) {
+            printf("Headless: no EGL config for OpenGL\n");
+            return false;
+        }
+        config = EGL_NO_CONFIG_KHR;
+    }
+
+    //same version the shaders ask for, core profile since that's what Mesa goes furthest with
+    const EGLint contextAttribs[] = {
+        EGL_CONTEXT_MAJOR_VERSION_KHR, 4,
+        EGL_CONTEXT_MINOR_VERSION_KHR, 0,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK_KHR, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT_KHR,
+        EGL_NONE
+    };
+    EGLContext ctx = eglCreateContext(dpy, config, EGL_NO_CONTEXT, contextAttribs);
+    if (ctx == EGL_NO_CONTEXT) {
+        printf("Headless: could not create an OpenGL 4.0 context (0x%x)\n", eglGetError());
+        return false;
+    }
+    context = ctx;
+    if (!eglMakeCurrent(dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, ctx)) {
+        printf("Headless: could not make the context current (0x%x)\n", eglGetError());
+        return false;
+    }
+    printf("Headless: EGL %d.%d, %s\n", major, minor, eglQueryString(dpy, EGL_VENDOR));
+    return true;
+}
+
+#endif
+
+bool HeadlessContext::createFramebuffer(int w, int h) {
+    width = w;
+    height = h;
+    glGenRenderbuffers(1, &colorRB);
+    glBindRenderbuffer(GL_RENDERBUFFER, colorRB);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glGenRenderbuffers(1, &depthRB);
+    glBindRenderbuffer(GL_RENDERBUFFER, depthRB);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glGenFramebuffers(1, &fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorRB);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthRB);
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        printf("Headless: %dx%d framebuffer incomplete (0x%x)\n", width, height, status);
+        return false;
+    }
+    bind();
+    return true;
+}
+
+void HeadlessContext::bind() {
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glViewport(0, 0, width, height);
+}
+
+void HeadlessContext::destroy() {
+    if (fbo) {
+        glDeleteFramebuffers(1, &fbo);
+        glDeleteRenderbuffers(1, &colorRB);
+        glDeleteRenderbuffers(1, &depthRB);
+        fbo = colorRB = depthRB = 0;
+    }
+#ifndef _WIN32
+    if (display) {
+        eglMakeCurrent((EGLDisplay)display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        if (context) eglDestroyContext((EGLDisplay)display, (EGLContext)context);
+        eglTerminate((EGLDisplay)display);
+    }
+#endif
+    display = context = NULL;
+}
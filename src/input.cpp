@@ -1,6 +1,7 @@
 #include "input.h"
 #include <GLFW/glfw3.h>     // Windows and input
 #include "globals.h"
+#include <stdio.h>
 
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods) {
     if (action == GLFW_PRESS or action == GLFW_REPEAT) {
@@ -8,6 +9,21 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
             glfwSetWindowShouldClose(window, GL_TRUE);
         }
     }
+    if (action == GLFW_PRESS && key == GLFW_KEY_C) {
+        cachePaintings = !cachePaintings;
+        printf("Painting cache %s\n", cachePaintings ? "on" : "off");
+    }
+    if (action == GLFW_PRESS && key == GLFW_KEY_P) {
+        depthPrepass = !depthPrepass;
+        printf("Depth prepass %s\n", depthPrepass ? "on" : "off");
+    }
+    if (action == GLFW_PRESS && key == GLFW_KEY_G) {
+        gpuProfile = !gpuProfile;
+        printf("GPU profiler %s\n", gpuProfile ? "on" : "off");
+    }
+    if (action == GLFW_PRESS && key == GLFW_KEY_L) {
+        dumpGpuProfile = true;
+    }
     if (action == GLFW_PRESS) {
         if (cam.keyboard.find(key) != cam.keyboard.end()) {
             cam.keyboard.at(key) = true;
@@ -6,6 +6,7 @@
 #include <vector>
 #include <unistd.h>         // Threading
 #include <stdio.h>          // Input/Output
+#include <string.h>
 #include <GLEW/glew.h>      // OpenGL Extension Wrangler -
 //#include <GL/glew.h> // this is the default include folder location in ubuntu...
 #include <GLFW/glfw3.h>     // Windows and input
@@ -22,6 +23,27 @@
 #include "cylinder.h"
 #include "halfsphere.h"
 #include "geometry.h"
+#include "frameglobals.h"
+#include "shaderloader.h"
+#include "shaderregistry.h"
+#include "paintingbatch.h"
+#include "geometrybatch.h"
+#include "paintingcache.h"
+#include "frustum.h"
+#include "renderstats.h"
+#include "renderqueue.h"
+#include "options.h"
+#include "headless.h"
+#include "frameclock.h"
+#include "camerapath.h"
+#include "benchmark.h"
+#include "exporter.h"
+#include "poster.h"
+#include "shards.h"
+#include "gpuprofiler.h"
+#include "profiler.h"
+#include "gldispatch.h"
+#include "glstate.h"
 
 // so far i've only added to this globals header globals which need to be visible across multiple files:
 // keyboard and cam
@@ -33,6 +55,14 @@ using std::make_unique;
 
 //our globals
 shader_prog basicshader("shaders/basic.vert.glsl", "shaders/basic.frag.glsl");
+shader_prog depthshader("shaders/basic.vert.glsl", "shaders/depth.frag.glsl");
+FrameUniforms frameUniforms;
+PaintingBatch paintingBatch;
+GeometryBatch geometryBatch;
+PaintingCache paintingCache;
+RenderQueue renderQueue;
+GpuProfiler gpuProfiler;
+uniform_handle basicModelLoc;
 GLuint floorVAO, paintingVAO;
 
 // all functions defined in main.cpp... it's ugly but i'm ok with it //
@@ -43,6 +73,7 @@ void drawWorld();
 GLuint importMesh(const std::string& pFile);
 
 vector<unique_ptr<Painting>> makePaintings() {
+    PROFILE_ZONE("makePaintings");
     //just making and placing them manually...
 
     vector<const char*> fragshaders{
@@ -75,7 +106,9 @@ vector<unique_ptr<Painting>> makePaintings() {
 
 void initGeom() {
     floorVAO = createQuad(glm::vec3(0.22, 0.22, 0.22), 50);
-    paintingVAO = createQuad(glm::vec3(0.50, 0.50, 0.50), 15);
+    paintingVAO = createQuad(glm::vec3(0.50, 0.50, 0.50), PAINTING_SIZE);
+    paintingBatch.init(paintingVAO);
+    geometryBatch.init();
 }
 
 GLuint createQuad(glm::vec3 color, float s) {
@@ -93,7 +126,7 @@ GLuint createQuad(glm::vec3 color, float s) {
 
     GLuint vertexArrayHandle;
     glGenVertexArrays(1, &vertexArrayHandle);
-    glBindVertexArray(vertexArrayHandle);
+    glState.bindVertexArray(vertexArrayHandle);
 
     GLuint vboHandle;
     glGenBuffers(1, &vboHandle);
@@ -139,97 +172,355 @@ GLuint createQuad(glm::vec3 color, float s) {
 
 void drawWorld() {
     basicshader.begin();
-    basicshader.uniformMatrix4fv("viewMatrix", cam.view);
     std::stack<glm::mat4> ms;
     ms.push(glm::mat4(1.0));
     ms.push(ms.top()); //Floor
         ms.top() = glm::rotate(ms.top(), glm::radians(-90.0f), glm::vec3(1.0, 0.0, 0.0));
         ms.top() = glm::translate(ms.top(), glm::vec3(0.0, 0.0, -10.0));
-        basicshader.uniformMatrix4fv("modelMatrix", ms.top());
-        glBindVertexArray(floorVAO);
+        basicshader.uniformMatrix4fv(basicModelLoc, ms.top());
+        glState.enable(GL_CULL_FACE, true);
+        glState.bindVertexArray(floorVAO);
         glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_BYTE, 0);
+        renderStats.drawCalls++;
     ms.pop();
     basicshader.end();
 }
 
 
 int main(int argc, char *argv[]) {
-    GLFWwindow *win;
-
-    if (!glfwInit()) {
-        exit (EXIT_FAILURE);
-    }
-
-    win = glfwCreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT, WINDOW_NAME, NULL, NULL);
-    if (!win) {
-        glfwTerminate();
+    GLFWwindow *win = NULL;
+    Options opts;
+    HeadlessContext headless;
+    FrameClock clock;
+    CameraPath path;
+    Benchmark benchmark;
+    Exporter exporter;
+
+    profileThreadName("main");
+    if (!parseOptions(argc, argv, opts) || !clock.configure(opts.clock)) {
         exit(EXIT_FAILURE);
     }
-    cam.win = win;
+    if (opts.exportPath && strcmp(opts.exportPath, "-") == 0) exporter.claimStdout();
+    //the JSON report on stdout has to parse, the logs go to stderr
+    if (opts.benchmark && (!opts.report || strcmp(opts.report, "-") == 0)) benchmark.claimStdout();
+    //the coordinator only starts and watches workers, it never touches GL
+    if (opts.shards > 0) exit(runShards(argc, argv, opts) ? EXIT_SUCCESS : EXIT_FAILURE);
+    //and neither do the C++ paintings
+    if (opts.posterShader && opts.cpu) {
+        bool ok = renderCpuPoster(opts.posterShader, opts.posterPath, opts.posterWidth, opts.posterHeight,
+                                  opts.posterTile, opts.posterTime, opts.threads);
+        exit(ok ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+    //exports fly the same path as the benchmark
+    bool flyPath = opts.benchmark || opts.exportPath;
+    if (flyPath) {
+        if (opts.path) {
+            if (!path.load(opts.path)) exit(EXIT_FAILURE);
+        } else {
+            path.gallery();
+        }
+    }
+
+    if (opts.headless) {
+        //no GLFW at all: it would want a display
+        if (!headless.init()) {
+            exit(EXIT_FAILURE);
+        }
+    } else {
+        if (!glfwInit()) {
+            exit (EXIT_FAILURE);
+        }
 
-    glfwMakeContextCurrent(win);
+        win = glfwCreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT, WINDOW_NAME, NULL, NULL);
+        if (!win) {
+            glfwTerminate();
+            exit(EXIT_FAILURE);
+        }
+        cam.win = win;
+
+        glfwMakeContextCurrent(win);
+        //vsync would just measure the monitor
+        if (opts.benchmark) glfwSwapInterval(0);
+    }
     glewExperimental = GL_TRUE;
     GLenum status = glewInit();
-
+    //the GLX build of GLEW loads the GL entry points, then looks for a GLX display to load the glX ones
+    //from. A surfaceless EGL context has none, which is all that error means there
+    if (!win && status == GLEW_ERROR_NO_GLX_DISPLAY) status = GLEW_OK;
     if(status != GLEW_OK) {
         fprintf(stderr, "Error: %s\n", glewGetErrorString(status));
+        exit(EXIT_FAILURE);
     }
+    //glewInit asks for GL_EXTENSIONS the old way, which a core context answers with an error
+    glGetError();
 
     const GLubyte* renderer = glGetString (GL_RENDERER); // get renderer string
     const GLubyte* version = glGetString (GL_VERSION); // version as a string
     printf ("Renderer: %s\n", renderer);
     printf ("OpenGL version supported %s\n", version);
-    glfwSetKeyCallback(win, key_callback);
-    glfwSetInputMode(win, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+    if (win) {
+        glfwSetKeyCallback(win, key_callback);
+        glfwSetInputMode(win, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+    } else {
+        if (!headless.createFramebuffer(opts.width, opts.height)) {
+            headless.destroy();
+            exit(EXIT_FAILURE);
+        }
+        cam.projection = glm::perspective(glm::radians(80.), (double)opts.width/opts.height, 0.1, 100.);
+        cam.updateViewMat();
+    }
 
+    frameUniforms.init();
+    startShaderLoader(win);
+    //the basic shader doubles as the placeholder for paintings that are still compiling, so wait for it
     basicshader.setup();
-    basicshader.begin();
-    basicshader.uniformMatrix4fv("projectionMatrix", cam.projection);
-    basicshader.uniformMatrix4fv("viewMatrix", cam.view);
+    basicModelLoc = basicshader.handle("modelMatrix");
+    Painting::placeholder = &basicshader;
+    Painting::placeholderModelLoc = basicModelLoc;
+    depthshader.setup();
+    Painting::depthshader = &depthshader;
+    Painting::depthModelLoc = depthshader.handle("modelMatrix");
 
     initGeom();
-    glEnable(GL_DEPTH_TEST);
-    glEnable(GL_CULL_FACE);
+    gpuProfiler.init();
+    gpuProfile = opts.gpuProfile;
+    glState.enable(GL_DEPTH_TEST, true);
+    glState.enable(GL_CULL_FACE, true);
     glCullFace(GL_BACK);
     glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 
+    //a poster is one painting and nothing else, the frame globals say how big the whole of it is
+    if (opts.posterShader) {
+        frameUniforms.update(cam, opts.posterTime, 0.f, glm::vec2(opts.posterWidth, opts.posterHeight), 0);
+        bool ok = renderPoster(opts.posterShader, opts.posterPath, opts.posterWidth, opts.posterHeight, opts.posterTile, paintingVAO);
+        stopShaderLoader();
+        headless.destroy();
+        exit(ok ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+    if (opts.compareShader) {
+        frameUniforms.update(cam, opts.posterTime, 0.f, glm::vec2(opts.width, opts.height), 0);
+        bool ok = comparePainting(opts.compareShader, opts.width, opts.height, opts.posterTime, opts.tolerance, opts.maxOutliers,
+                                  opts.threads, paintingVAO);
+        stopShaderLoader();
+        headless.destroy();
+        exit(ok ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+
     //create a vector containing (unique) pointers to our "paintings": they are initialized inside this makePaintings function
     auto paintings = makePaintings();
-    double currentTime, dt, lastTime = 0;
+    paintingCache.init();
+    for (const auto &p : paintings) {
+        paintingCache.add(p.get());
+    }
+    double lastTitleTime = 0;
+    int frames = 0;
 
-    auto dome = make_unique<Geometry>("data/halfsphere.obj", "shaders/dome.vert.glsl", "shaders/basic.frag.glsl");
+    //every Geometry of the same file shares one GpuMesh, and they're drawn instanced together
+    std::vector<std::unique_ptr<Geometry>> geometries;
+    auto dome = make_unique<Geometry>("data/halfsphere.obj", "shaders/dome.vert.glsl", "shaders/basic.frag.glsl", opts.quantize);
     dome->setPos(glm::vec3(0.f, 30.f, 20.f));
     dome->setAngle(0.f);
     dome->setScale(20.f);
+    geometries.push_back(std::move(dome));
+
+    size_t stagecount, programcount;
+    registry_stats(stagecount, programcount);
+    printf("Shader registry: %zu unique stages, %zu programs\n", stagecount, programcount);
+    size_t meshcount;
+    registryMeshStats(meshcount);
+    printf("Mesh registry: %zu meshes for %zu geometries\n", meshcount, geometries.size());
+
+    if (flyPath) {
+        //placeholders and compile hitches aren't what we're measuring (or want in a video), so wait for every program
+        bool compiling = true;
+        while (compiling) {
+            compiling = false;
+            for (const auto &g : geometries) {
+                if (!g->ready() || !g->instanceable()) compiling = true;
+            }
+            for (const auto &p : paintings) {
+                if (!p->ready()) compiling = true;
+            }
+            if (compiling) usleep(1000);
+        }
+        if (opts.benchmark) benchmark.init();
+    }
+    if (opts.exportPath && !exporter.open(opts.exportPath, opts.exportFormat, opts.width, opts.height, opts.fps, opts.frameStart)) {
+        headless.destroy();
+        exit(EXIT_FAILURE);
+    }
+    //a shard worker picks the render up at its first frame
+    clock.seek(opts.frameStart);
+
+
+
+    while (!win || !glfwWindowShouldClose(win)) {
+        if (opts.frameEnd > 0 && clock.frame() + 1 >= opts.frameEnd) break;
+        //nothing more would reach the disk
+        if (exporter.failing()) break;
+        PROFILE_ZONE("frame");
+        //the only place time is read, everything this frame draws with the same value
+        clock.tick();
+        float currentTime = (float)clock.time(), dt = (float)clock.dt();
+        if (flyPath) {
+            CameraKey k = path.sample(opts.frames > 1 ? (float)clock.frame() / (opts.frames - 1) : 0.f);
+            cam.setPose(k.position, k.rotation);
+            if (opts.benchmark) benchmark.beginFrame();
+        } else if (win) {
+            PROFILE_ZONE("input");
+            cam.processInput(dt);
+        }
 
+        int fbwidth = opts.width, fbheight = opts.height;
+        if (win) glfwGetFramebufferSize(win, &fbwidth, &fbheight);
+        else headless.bind();
+        //everything time/camera related gets uploaded once here, shared by all programs
+        frameUniforms.update(cam, currentTime, dt, glm::vec2(fbwidth, fbheight), clock.frame());
+        renderStats.reset();
+        Frustum frustum;
+        frustum.extract(frameUniforms.current().viewProjection);
 
+        gpuProfiler.enabled = gpuProfile;
+        if (gpuProfile) gpuProfiler.beginFrame();
 
-    while (!glfwWindowShouldClose(win)) {
-        currentTime = glfwGetTime();
-        dt = (currentTime - lastTime);
-        lastTime = currentTime;
-        cam.processInput(dt);
-
+        //the overlay may have switched it off at the end of the last frame
+        glState.enable(GL_DEPTH_TEST, true);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
+        {
+            PROFILE_ZONE("drawWorld");
+            GpuZone zone(&gpuProfiler, "floor");
+            drawWorld();
+        }
 
-        drawWorld();
-
-        for (const auto &p : paintings) {
-            p->render(paintingVAO);
+        //opaque draws go through the queue, sorted front to back (and depth-prepassed if enabled)
+        const glm::mat4 &view = frameUniforms.current().view;
+        renderQueue.clear();
+        if (cachePaintings) {
+            //paintings come out of their textures, only a budgeted few get re-rendered this frame
+            PROFILE_ZONE("painting cache");
+            GpuZone zone(&gpuProfiler, "painting cache");
+            paintingCache.update(paintingVAO, frameUniforms, glm::ivec2(fbwidth, fbheight));
+            paintingCache.draw(paintingVAO, frustum);
+        } else {
+            //paintings sharing a program are drawn with one instanced call per group, the rest one by one
+            PROFILE_ZONE("queue paintings");
+            paintingBatch.clear();
+            for (const auto &p : paintings) {
+                if (!frustum.intersects(p->bounds())) {
+                    renderStats.culled++;
+                    continue;
+                }
+                renderStats.drawn++;
+                Painting *pp = p.get();
+                float depth = viewDepth(view, pp->position);
+                if (!pp->ready()) {
+                    renderQueue.add("placeholders", depth, basicshader, [pp]{ pp->renderPlaceholder(paintingVAO); },
+                                                                        [pp]{ pp->renderDepth(paintingVAO); });
+                } else if (pp->instanceable()) {
+                    paintingBatch.add(pp);
+                } else {
+                    renderQueue.add(pp->name.c_str(), depth, pp->pshader, [pp]{ pp->render(paintingVAO); },
+                                                                          [pp]{ pp->renderDepth(paintingVAO); });
+                }
+            }
+            paintingBatch.build(view);
+            for (size_t i = 0; i < paintingBatch.groupCount(); i++) {
+                renderQueue.add(paintingBatch.groupName(i), paintingBatch.groupDepth(i), paintingBatch.groupProgram(i),
+                                [i]{ paintingBatch.drawGroup(i); }, [i]{ paintingBatch.drawGroupDepth(i); });
+            }
         }
 
-        dome->render();
+        {
+            PROFILE_ZONE("queue geometry");
+            geometryBatch.clear();
+            for (const auto &g : geometries) {
+                if (!frustum.intersects(g->bounds())) {
+                    renderStats.culled++;
+                    continue;
+                }
+                renderStats.drawn++;
+                Geometry *gp = g.get();
+                if (gp->instanceable()) {
+                    geometryBatch.add(gp);
+                } else if (gp->ready()) {
+                    renderQueue.add(gp->name.c_str(), viewDepth(view, gp->bounds().center), 0, [gp]{ gp->render(); },
+                                                                                             [gp]{ gp->renderDepth(); });
+                }
+            }
+            geometryBatch.build(view);
+            for (size_t i = 0; i < geometryBatch.groupCount(); i++) {
+                renderQueue.add(geometryBatch.groupName(i), geometryBatch.groupDepth(i), geometryBatch.groupProgram(i),
+                                [i]{ geometryBatch.drawGroup(i); }, [i]{ geometryBatch.drawGroupDepth(i); });
+            }
+        }
+        {
+            //the paintings and the geometry render in here
+            PROFILE_ZONE("render queue");
+            renderQueue.render(depthPrepass, &gpuProfiler);
+        }
 
+        if (gpuProfile && win) gpuProfiler.drawOverlay();
+        if (dumpGpuProfile) {
+            gpuProfiler.dump(stdout);
+            dumpGpuProfile = false;
+        }
+        if (exporter.active()) exporter.capture();
+
+        //frame rate and culling numbers in the title bar, twice a second
+        //(real time, the frame clock may well be a fixed step)
+        frames++;
+        double wallTime = clock.wall();
+        if (win && wallTime - lastTitleTime > 0.5) {
+            char title[128];
+            snprintf(title, sizeof(title), "%s - %.0f fps, %u drawn, %u culled", WINDOW_NAME,
+                     frames / (wallTime - lastTitleTime), renderStats.drawn, renderStats.culled);
+            glfwSetWindowTitle(win, title);
+            lastTitleTime = wallTime;
+            frames = 0;
+        }
 
-        glfwSwapBuffers(win);
-        glfwPollEvents();
-        usleep(1000);
+        if (win) {
+            {
+                PROFILE_ZONE("glfwSwapBuffers");
+                glfwSwapBuffers(win);
+            }
+            {
+                PROFILE_ZONE("glfwPollEvents");
+                glfwPollEvents();
+            }
+            if (!opts.benchmark) {
+                PROFILE_ZONE("usleep");
+                usleep(1000);
+            }
+        }
+        glDispatchEndFrame();
+        if (opts.benchmark) benchmark.endFrame(renderStats, glDispatchLastFrame());
+    }
+    if (opts.benchmark) {
+        benchmark.finish();
+        glm::vec2 res = frameUniforms.current().resolution;
+        benchmark.write(opts.report, (const char *)renderer, (int)res.x, (int)res.y, opts.clock);
+    }
+    bool exported = exporter.finish();
+    if (!win) {
+        glFinish();
+        double elapsed = clock.wall();
+        long frameCount = clock.frame() + 1 - opts.frameStart;
+        printf("Headless: %ld frames at %dx%d in %.2fs (%.1f fps)\n", frameCount, opts.width, opts.height,
+               elapsed, frameCount / elapsed);
     }
+    if (opts.trace) profileWriteTrace(opts.trace);
+    if (glDispatchEnabled()) glDispatchPrintAverages(stderr);
+    //stderr, stdout may be carrying the benchmark report
+    if (opts.gpuProfile) gpuProfiler.dump(stderr);
     //clear it out
+    stopShaderLoader();
 
-    glfwTerminate();
-    exit(EXIT_SUCCESS);
+    if (win) glfwTerminate();
+    else headless.destroy();
+    //an export that didn't get every frame out fails the run, --shards goes by that too
+    exit(exported ? EXIT_SUCCESS : EXIT_FAILURE);
 
     return 0;
 }
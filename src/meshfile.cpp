@@ -0,0 +1,281 @@
+#include "meshfile.h"
+#include "fileutil.h"
+#include "meshopt.h"
+#include "profiler.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sys/stat.h>
+#include <glm/gtc/packing.hpp>
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+namespace {
+    const char magic[4] = {'G', 'A', 'M', 'F'};
+
+    bool sourceStat(const char *objfile, uint64_t &size, int64_t &time) {
+        struct stat st;
+        if (stat(objfile, &st) != 0) return false;
+        size = st.st_size;
+        time = st.st_mtime;
+        return true;
+    }
+
+    //onto the octahedron |x|+|y|+|z| = 1, the lower half folded over the upper one
+    glm::vec2 octEncode(glm::vec3 n) {
+        float l1 = fabsf(n.x) + fabsf(n.y) + fabsf(n.z);
+        if (l1 == 0.f) return glm::vec2(0.f);
+        n /= l1;
+        glm::vec2 e(n.x, n.y);
+        if (n.z < 0.f) {
+            e.x = (1.f - fabsf(n.y)) * (n.x >= 0.f ? 1.f : -1.f);
+            e.y = (1.f - fabsf(n.x)) * (n.y >= 0.f ? 1.f : -1.f);
+        }
+        return e;
+    }
+}
+
+bool meshImport(const char *objfile, MeshData &out) {
+    PROFILE_ZONE("meshImport");
+    Assimp::Importer importer;
+
+    const aiScene *scene = importer.ReadFile(objfile,
+        aiProcess_CalcTangentSpace       |
+        aiProcess_Triangulate            |
+        aiProcess_JoinIdenticalVertices  |
+        aiProcess_SortByPType);
+
+    if (!scene || scene->mNumMeshes == 0) {
+        printf("Error importing a file: %s\n", importer.GetErrorString());
+        return false;
+    }
+
+    printf("Loaded mesh: %s \n", scene->mMeshes[0][0].mName.C_Str());
+
+    aiMesh *imported = scene->mMeshes[0];
+    //points or lines only, say, and there's nothing to draw or put a bounding sphere around
+    if (imported->mNumVertices == 0) {
+        printf("Error importing a file: %s has no vertices\n", objfile);
+        return false;
+    }
+    printf("number of vertices: %d, number of faces: %d\n", imported->mNumVertices, imported->mNumFaces);
+
+    out.vertices.clear();
+    out.vertices.reserve(imported->mNumVertices * MESH_VERTEX_FLOATS);
+    for (unsigned int i = 0; i < imported->mNumVertices; i++) {
+        aiVector3D uv = imported->HasTextureCoords(0) ? imported->mTextureCoords[0][i] : aiVector3D();
+        aiVector3D n = imported->HasNormals() ? imported->mNormals[i] : aiVector3D();
+        out.vertices.push_back(imported->mVertices[i].x);
+        out.vertices.push_back(imported->mVertices[i].y);
+        out.vertices.push_back(imported->mVertices[i].z);
+        out.vertices.push_back(uv.x);
+        out.vertices.push_back(uv.y);
+        out.vertices.push_back(n.x);
+        out.vertices.push_back(n.y);
+        out.vertices.push_back(n.z);
+    }
+
+    //bounding sphere around the box of the vertices, used for culling
+    glm::vec3 lo(imported->mVertices[0].x, imported->mVertices[0].y, imported->mVertices[0].z), hi = lo;
+    for (unsigned int i = 1; i < imported->mNumVertices; i++) {
+        glm::vec3 v(imported->mVertices[i].x, imported->mVertices[i].y, imported->mVertices[i].z);
+        lo = glm::min(lo, v);
+        hi = glm::max(hi, v);
+    }
+    out.bounds.center = (lo + hi) * 0.5f;
+    out.bounds.radius = 0.f;
+    for (unsigned int i = 0; i < imported->mNumVertices; i++) {
+        glm::vec3 v(imported->mVertices[i].x, imported->mVertices[i].y, imported->mVertices[i].z);
+        out.bounds.radius = glm::max(out.bounds.radius, glm::length(v - out.bounds.center));
+    }
+
+    // we know its triangles
+    out.indices.clear();
+    out.indices.reserve(imported->mNumFaces * 3);
+    for (unsigned int i = 0; i < imported->mNumFaces; i++) {
+        for (unsigned int j = 0; j < imported->mFaces[i].mNumIndices; j++){
+            out.indices.push_back(imported->mFaces[i].mIndices[j]);
+        }
+    }
+    meshOptimize(out.vertices, out.indices, MESH_VERTEX_FLOATS);
+    return true;
+}
+
+std::string meshCachePath(const char *objfile) {
+    std::string name(objfile);
+    for (char &c : name) {
+        if (c == '/' || c == '\\' || c == ':') c = '_';
+    }
+    return std::string(MESH_CACHE_DIR) + "/" + name + ".mesh";
+}
+
+bool meshWrite(const std::string &path, const char *objfile, const MeshData &mesh) {
+    MeshHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, magic, 4);
+    header.version = MESH_FORMAT_VERSION;
+    header.vertexFloats = MESH_VERTEX_FLOATS;
+    header.vertexCount = mesh.vertices.size() / MESH_VERTEX_FLOATS;
+    header.indexCount = mesh.indices.size();
+    if (!sourceStat(objfile, header.sourceSize, header.sourceTime)) return false;
+    header.center[0] = mesh.bounds.center.x;
+    header.center[1] = mesh.bounds.center.y;
+    header.center[2] = mesh.bounds.center.z;
+    header.radius = mesh.bounds.radius;
+    header.vertexOffset = sizeof(header);
+    header.indexOffset = header.vertexOffset + mesh.vertices.size() * sizeof(float);
+
+    size_t slash = path.rfind('/');
+    if (slash != std::string::npos && !make_dirs(path.substr(0, slash))) return false;
+    std::string tmp = path + ".tmp";
+    std::ofstream out(tmp.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    out.write((const char*)&header, sizeof(header));
+    out.write((const char*)mesh.vertices.data(), mesh.vertices.size() * sizeof(float));
+    out.write((const char*)mesh.indices.data(), mesh.indices.size() * sizeof(uint32_t));
+    out.close();
+    if (!out || std::rename(tmp.c_str(), path.c_str()) != 0) {
+        std::remove(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+void meshQuantize(const float *vertices, uint32_t count, std::vector<QuantizedVertex> &out, glm::vec3 &offset, glm::vec3 &scale) {
+    out.resize(count);
+    if (count == 0) return;
+    glm::vec3 lo(vertices[0], vertices[1], vertices[2]), hi = lo;
+    for (uint32_t i = 1; i < count; i++) {
+        const float *v = vertices + i * MESH_VERTEX_FLOATS;
+        lo = glm::min(lo, glm::vec3(v[0], v[1], v[2]));
+        hi = glm::max(hi, glm::vec3(v[0], v[1], v[2]));
+    }
+    offset = lo;
+    scale = hi - lo;
+    //a flat mesh has no extent along some axis, everything there quantizes to 0
+    glm::vec3 inv(scale.x > 0.f ? 1.f / scale.x : 0.f, scale.y > 0.f ? 1.f / scale.y : 0.f, scale.z > 0.f ? 1.f / scale.z : 0.f);
+
+    for (uint32_t i = 0; i < count; i++) {
+        const float *v = vertices + i * MESH_VERTEX_FLOATS;
+        QuantizedVertex &q = out[i];
+        glm::vec3 p = glm::clamp((glm::vec3(v[0], v[1], v[2]) - lo) * inv, 0.f, 1.f);
+        q.position[0] = (uint16_t)(p.x * 65535.f + 0.5f);
+        q.position[1] = (uint16_t)(p.y * 65535.f + 0.5f);
+        q.position[2] = (uint16_t)(p.z * 65535.f + 0.5f);
+        q.position[3] = 0;
+        q.uv[0] = glm::packHalf1x16(v[3]);
+        q.uv[1] = glm::packHalf1x16(v[4]);
+        glm::vec2 n = glm::clamp(octEncode(glm::vec3(v[5], v[6], v[7])), -1.f, 1.f);
+        q.normal[0] = (int16_t)roundf(n.x * 32767.f);
+        q.normal[1] = (int16_t)roundf(n.y * 32767.f);
+    }
+}
+
+MeshFile::MeshFile() :
+    base(NULL),
+    size(0),
+    header(NULL)
+    {}
+
+MeshFile::~MeshFile() {
+    close();
+}
+
+bool MeshFile::open(const std::string &path, const char *objfile) {
+    PROFILE_ZONE("MeshFile::open");
+    close();
+#ifdef _WIN32
+    //no mmap here, a single read is the next best thing
+    FILE *f = fopen(path.c_str(), "rb");
+    if (!f) return false;
+    fseek(f, 0, SEEK_END);
+    size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    base = malloc(size);
+    bool read = base && fread(base, 1, size, f) == size;
+    fclose(f);
+    if (!read) {
+        close();
+        return false;
+    }
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(MeshHeader)) {
+        ::close(fd);
+        return false;
+    }
+    size = st.st_size;
+    base = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (base == MAP_FAILED) {
+        base = NULL;
+        size = 0;
+        return false;
+    }
+#endif
+    header = (const MeshHeader*)base;
+
+    uint64_t sourceSize;
+    int64_t sourceTime;
+    bool valid = size >= sizeof(MeshHeader)
+                 && std::memcmp(header->magic, magic, 4) == 0
+                 && header->version == MESH_FORMAT_VERSION
+                 && header->vertexFloats == MESH_VERTEX_FLOATS
+                 && header->vertexCount > 0
+                 && header->vertexOffset + (uint64_t)header->vertexCount * MESH_VERTEX_FLOATS * sizeof(float) <= header->indexOffset
+                 && header->indexOffset + (uint64_t)header->indexCount * sizeof(uint32_t) <= size;
+    //a missing source is fine, the cache can ship without the .obj
+    if (valid && sourceStat(objfile, sourceSize, sourceTime))
+        valid = sourceSize == header->sourceSize && sourceTime == header->sourceTime;
+    //a corrupt index would have the GPU fetch past the vertex buffer (and wrap in the 16 bit path),
+    //one pass over them is nothing next to the upload
+    if (valid) {
+        const uint32_t *index = indices();
+        for (uint32_t i = 0; valid && i < header->indexCount; i++) valid = index[i] < header->vertexCount;
+    }
+    if (!valid) {
+        printf("Discarding stale mesh cache entry %s\n", path.c_str());
+        close();
+    }
+    return valid;
+}
+
+void MeshFile::close() {
+#ifdef _WIN32
+    free(base);
+#else
+    if (base) munmap(base, size);
+#endif
+    base = NULL;
+    size = 0;
+    header = NULL;
+}
+
+uint32_t MeshFile::vertexCount() const {
+    return header->vertexCount;
+}
+
+uint32_t MeshFile::indexCount() const {
+    return header->indexCount;
+}
+
+const float *MeshFile::vertices() const {
+    return (const float*)((const char*)base + header->vertexOffset);
+}
+
+const uint32_t *MeshFile::indices() const {
+    return (const uint32_t*)((const char*)base + header->indexOffset);
+}
+
+BoundingSphere MeshFile::bounds() const {
+    return BoundingSphere{glm::vec3(header->center[0], header->center[1], header->center[2]), header->radius};
+}
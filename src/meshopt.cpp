@@ -0,0 +1,225 @@
+#include "meshopt.h"
+#include "profiler.h"
+#include <cmath>
+#include <cstdio>
+#include <algorithm>
+#include <glm/glm.hpp>
+
+namespace {
+    //Forsyth's scoring constants, as in his write-up
+    const float cacheDecayPower = 1.5f;
+    const float lastTriScore = 0.75f;
+    const float valenceBoostScale = 2.f;
+    const float valenceBoostPower = 0.5f;
+
+    //valence is the number of triangles still to be emitted that use the vertex
+    float vertexScore(int cachePos, uint32_t valence) {
+        if (valence == 0) return -1.f;
+        float score = 0.f;
+        if (cachePos >= 0) {
+            //the last triangle's vertices get a fixed score, so it doesn't matter which one went in first
+            if (cachePos < 3) score = lastTriScore;
+            else score = powf(1.f - (float)(cachePos - 3) / (MESHOPT_CACHE_SIZE - 3), cacheDecayPower);
+        }
+        return score + valenceBoostScale * powf((float)valence, -valenceBoostPower);
+    }
+
+    glm::vec3 position(const std::vector<float> &vertices, int stride, uint32_t v) {
+        return glm::vec3(vertices[v * stride], vertices[v * stride + 1], vertices[v * stride + 2]);
+    }
+}
+
+//FIFO cache simulated with timestamps: a vertex is in the cache if fewer than cacheSize misses happened since its own
+MeshCacheStats meshAnalyzeVertexCache(const std::vector<uint32_t> &indices, uint32_t vertexCount, int cacheSize) {
+    MeshCacheStats stats = {0.f, 0.f};
+    if (indices.empty() || vertexCount == 0) return stats;
+    std::vector<uint32_t> cacheTime(vertexCount, 0);
+    uint32_t timestamp = cacheSize, misses = 0;
+    for (uint32_t v : indices) {
+        if (timestamp - cacheTime[v] >= (uint32_t)cacheSize) {
+            cacheTime[v] = ++timestamp;
+            misses++;
+        }
+    }
+    stats.acmr = (float)misses / (indices.size() / 3);
+    stats.atvr = (float)misses / vertexCount;
+    return stats;
+}
+
+//greedy: always emit the best scoring triangle among those using a vertex in the (simulated LRU) cache,
+//only the ones touched by the cache change get rescored, so it stays linear in the triangle count
+void meshOptimizeVertexCache(std::vector<uint32_t> &indices, uint32_t vertexCount) {
+    size_t triCount = indices.size() / 3;
+    if (triCount == 0) return;
+
+    //triangles using each vertex, as ranges in one array: valence[v] of them from offsets[v]
+    std::vector<uint32_t> valence(vertexCount, 0), offsets(vertexCount + 1, 0), adjacency(indices.size());
+    for (uint32_t v : indices) valence[v]++;
+    for (uint32_t v = 0; v < vertexCount; v++) offsets[v + 1] = offsets[v] + valence[v];
+    std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+    for (size_t i = 0; i < indices.size(); i++) adjacency[fill[indices[i]]++] = i / 3;
+
+    std::vector<int> cachePos(vertexCount, -1);
+    std::vector<float> vscore(vertexCount), tscore(triCount);
+    for (uint32_t v = 0; v < vertexCount; v++) vscore[v] = vertexScore(-1, valence[v]);
+    int best = 0;
+    for (size_t t = 0; t < triCount; t++) {
+        tscore[t] = vscore[indices[t * 3]] + vscore[indices[t * 3 + 1]] + vscore[indices[t * 3 + 2]];
+        if (tscore[t] > tscore[best]) best = t;
+    }
+
+    std::vector<bool> emitted(triCount, false);
+    std::vector<uint32_t> out, cache, next;
+    out.reserve(indices.size());
+    cache.reserve(MESHOPT_CACHE_SIZE + 3);
+    next.reserve(MESHOPT_CACHE_SIZE + 3);
+    size_t cursor = 0;
+
+    while (best >= 0) {
+        const uint32_t *tri = &indices[best * 3];
+        emitted[best] = true;
+        out.insert(out.end(), tri, tri + 3);
+
+        //the triangle's vertices go to the front, the rest of the cache moves back
+        next.assign(tri, tri + 3);
+        for (uint32_t v : cache) {
+            if (v != tri[0] && v != tri[1] && v != tri[2]) next.push_back(v);
+        }
+        for (int k = 0; k < 3; k++) {
+            uint32_t *list = &adjacency[offsets[tri[k]]];
+            uint32_t *end = list + valence[tri[k]];
+            *std::find(list, end, (uint32_t)best) = end[-1];
+            valence[tri[k]]--;
+        }
+        //next also holds whatever fell off the end, those get rescored as out of the cache
+        for (size_t i = 0; i < next.size(); i++) {
+            cachePos[next[i]] = i < MESHOPT_CACHE_SIZE ? (int)i : -1;
+            vscore[next[i]] = vertexScore(cachePos[next[i]], valence[next[i]]);
+        }
+
+        best = -1;
+        float bestScore = -1.f;
+        for (uint32_t v : next) {
+            for (uint32_t i = offsets[v]; i < offsets[v] + valence[v]; i++) {
+                uint32_t t = adjacency[i];
+                tscore[t] = vscore[indices[t * 3]] + vscore[indices[t * 3 + 1]] + vscore[indices[t * 3 + 2]];
+                if (tscore[t] > bestScore) {
+                    bestScore = tscore[t];
+                    best = t;
+                }
+            }
+        }
+        if (next.size() > MESHOPT_CACHE_SIZE) next.resize(MESHOPT_CACHE_SIZE);
+        cache.swap(next);
+
+        //nothing in the cache has triangles left: carry on with the next one in the original order
+        if (best < 0) {
+            while (cursor < triCount && emitted[cursor]) cursor++;
+            if (cursor < triCount) best = cursor;
+        }
+    }
+    indices.swap(out);
+}
+
+//cuts the (cache ordered) triangles into runs that are each about as cache friendly as the whole,
+//then draws the runs facing away from the middle of the mesh first: those are the ones in front
+//from most viewpoints, so they fill the depth buffer before what they hide
+void meshOptimizeOverdraw(std::vector<uint32_t> &indices, const std::vector<float> &vertices, int stride, float threshold) {
+    size_t triCount = indices.size() / 3;
+    uint32_t vertexCount = vertices.size() / stride;
+    if (triCount == 0) return;
+    float target = meshAnalyzeVertexCache(indices, vertexCount).acmr * threshold;
+
+    //each run starts from a cold cache, so ending it doesn't make the next one pay for it twice
+    std::vector<size_t> starts;
+    std::vector<uint32_t> cacheTime(vertexCount, 0);
+    uint32_t timestamp = MESHOPT_FIFO_SIZE, misses = 0;
+    size_t start = 0;
+    for (size_t t = 0; t < triCount; t++) {
+        for (int k = 0; k < 3; k++) {
+            uint32_t v = indices[t * 3 + k];
+            if (timestamp - cacheTime[v] >= MESHOPT_FIFO_SIZE) {
+                cacheTime[v] = ++timestamp;
+                misses++;
+            }
+        }
+        if (misses <= target * (t + 1 - start)) {
+            starts.push_back(start);
+            start = t + 1;
+            misses = 0;
+            timestamp += MESHOPT_FIFO_SIZE;
+        }
+    }
+    if (start < triCount) starts.push_back(start);
+    starts.push_back(triCount);
+    if (starts.size() <= 2) return;
+
+    //area weighted centroids, normals as the sum of the (area scaled) face normals
+    struct Cluster {
+        size_t start, end;
+        float key;
+    };
+    std::vector<Cluster> clusters;
+    std::vector<glm::vec3> centroids, normals;
+    glm::vec3 meshCentroid(0.f);
+    float meshArea = 0.f;
+    for (size_t c = 0; c + 1 < starts.size(); c++) {
+        glm::vec3 centroid(0.f), normal(0.f);
+        float area = 0.f;
+        for (size_t t = starts[c]; t < starts[c + 1]; t++) {
+            glm::vec3 a = position(vertices, stride, indices[t * 3]);
+            glm::vec3 b = position(vertices, stride, indices[t * 3 + 1]);
+            glm::vec3 d = position(vertices, stride, indices[t * 3 + 2]);
+            glm::vec3 n = glm::cross(b - a, d - a);
+            float triArea = glm::length(n);
+            centroid += (a + b + d) * (triArea / 3.f);
+            normal += n;
+            area += triArea;
+        }
+        meshCentroid += centroid;
+        meshArea += area;
+        centroids.push_back(area > 0.f ? centroid / area : centroid);
+        normals.push_back(glm::length(normal) > 0.f ? glm::normalize(normal) : normal);
+        clusters.push_back(Cluster{starts[c], starts[c + 1], 0.f});
+    }
+    if (meshArea > 0.f) meshCentroid /= meshArea;
+    for (size_t c = 0; c < clusters.size(); c++) {
+        clusters[c].key = glm::dot(centroids[c] - meshCentroid, normals[c]);
+    }
+    std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster &a, const Cluster &b) {
+        return a.key > b.key;
+    });
+
+    std::vector<uint32_t> out;
+    out.reserve(indices.size());
+    for (const Cluster &c : clusters) {
+        out.insert(out.end(), indices.begin() + c.start * 3, indices.begin() + c.end * 3);
+    }
+    indices.swap(out);
+}
+
+void meshOptimizeVertexFetch(std::vector<float> &vertices, std::vector<uint32_t> &indices, int stride) {
+    const uint32_t unused = ~0u;
+    std::vector<uint32_t> remap(vertices.size() / stride, unused);
+    std::vector<float> out;
+    out.reserve(vertices.size());
+    uint32_t count = 0;
+    for (uint32_t &v : indices) {
+        if (remap[v] == unused) {
+            remap[v] = count++;
+            out.insert(out.end(), vertices.begin() + v * stride, vertices.begin() + (v + 1) * stride);
+        }
+        v = remap[v];
+    }
+    vertices.swap(out);
+}
+
+void meshOptimize(std::vector<float> &vertices, std::vector<uint32_t> &indices, int stride) {
+    PROFILE_ZONE("meshOptimize");
+    MeshCacheStats before = meshAnalyzeVertexCache(indices, vertices.size() / stride);
+    meshOptimizeVertexCache(indices, vertices.size() / stride);
+    meshOptimizeOverdraw(indices, vertices, stride);
+    meshOptimizeVertexFetch(vertices, indices, stride);
+    MeshCacheStats after = meshAnalyzeVertexCache(indices, vertices.size() / stride);
+    printf("vertex cache: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n", before.acmr, after.acmr, before.atvr, after.atvr);
+}
@@ -0,0 +1,151 @@
+#include "meshregistry.h"
+#include "meshfile.h"
+#include "consts.h"
+#include "glstate.h"
+#include "profiler.h"
+#include <map>
+#include <vector>
+#include <cstdio>
+#include <cstddef>
+#include <glm/gtc/matrix_transform.hpp>
+
+namespace {
+    //like the shader programs, meshes only live as long as something uses them
+    std::map<std::pair<std::string, bool>, std::weak_ptr<GpuMesh>> meshes;
+
+    void upload(GpuMesh &mesh, const GLfloat *vertexdata, GLuint numVertices, const GLuint *indices, GLuint numIndices) {
+        mesh.numIndices = numIndices;
+
+        glGenVertexArrays(1, &mesh.VAO);
+        glState.bindVertexArray(mesh.VAO);
+
+        glGenBuffers(1, &mesh.vertexBuffer);
+        glBindBuffer(GL_ARRAY_BUFFER, mesh.vertexBuffer);
+
+        if (mesh.quantized) {
+            //see QuantizedVertex, positions get back to mesh space through decodeMatrix
+            std::vector<QuantizedVertex> packed;
+            glm::vec3 offset, extent;
+            meshQuantize(vertexdata, numVertices, packed, offset, extent);
+            mesh.decodeMatrix = glm::scale(glm::translate(glm::mat4(1.f), offset), extent);
+            glBufferData(GL_ARRAY_BUFFER, sizeof(QuantizedVertex)*packed.size(), packed.data(), GL_STATIC_DRAW);
+
+            glEnableVertexAttribArray(VERTEX_POSITION_LOC);
+            glVertexAttribPointer(VERTEX_POSITION_LOC, 3, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(QuantizedVertex),
+                                  (const GLvoid*)offsetof(QuantizedVertex, position));
+            glEnableVertexAttribArray(UV_LOC);
+            glVertexAttribPointer(UV_LOC, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(QuantizedVertex),
+                                  (const GLvoid*)offsetof(QuantizedVertex, uv));
+            glEnableVertexAttribArray(NORMAL_LOC);
+            glVertexAttribPointer(NORMAL_LOC, 2, GL_SHORT, GL_TRUE, sizeof(QuantizedVertex),
+                                  (const GLvoid*)offsetof(QuantizedVertex, normal));
+        } else {
+            glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat)*MESH_VERTEX_FLOATS*numVertices, vertexdata, GL_STATIC_DRAW);
+
+            glEnableVertexAttribArray(VERTEX_POSITION_LOC);
+            //indexes are defined inside the vertex shader itself with layout specification
+            glVertexAttribPointer(
+                VERTEX_POSITION_LOC,
+                3,
+                GL_FLOAT,
+                GL_FALSE,
+                MESH_VERTEX_FLOATS*sizeof(GLfloat),
+                (const GLvoid*)(0*sizeof(GLfloat))
+            );
+
+            //vx, vy, vz, u, v, nx, ny, nz
+            glEnableVertexAttribArray(NORMAL_LOC);
+            glVertexAttribPointer(
+                NORMAL_LOC,
+                3,                 // number of elements per vertex, here
+                GL_FLOAT,          // the type of each element
+                GL_FALSE,          // take our values as-is
+                MESH_VERTEX_FLOATS*sizeof(GLfloat), // stride
+                (const GLvoid*)(5*sizeof(GLfloat))                  // offset of first element
+            );
+
+            glEnableVertexAttribArray(UV_LOC);
+            glVertexAttribPointer(
+                UV_LOC,
+                2,
+                GL_FLOAT,
+                GL_FALSE,
+                MESH_VERTEX_FLOATS*sizeof(GLfloat),
+                (const GLvoid*)(3*sizeof(GLfloat))
+            );
+        }
+
+        //half the index bandwidth whenever the vertices fit (every index is below numVertices, MeshFile::open checks)
+        glGenBuffers(1, &mesh.indexBuffer);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.indexBuffer);
+        if (numVertices <= 65536) {
+            std::vector<GLushort> shortIndices(indices, indices + numIndices);
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLushort)*numIndices, shortIndices.data(), GL_STATIC_DRAW);
+            mesh.indexType = GL_UNSIGNED_SHORT;
+        } else {
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint)*numIndices, indices, GL_STATIC_DRAW);
+            mesh.indexType = GL_UNSIGNED_INT;
+        }
+    }
+
+    //from the binary cache when there's an up to date entry, else through assimp, writing the entry for next time
+    void import(GpuMesh &mesh, const char *objfile) {
+        PROFILE_ZONE("importMesh");
+        std::string path = meshCachePath(objfile);
+        MeshFile cached;
+        if (cached.open(path, objfile)) {
+            mesh.bounds = cached.bounds();
+            upload(mesh, cached.vertices(), cached.vertexCount(), cached.indices(), cached.indexCount());
+            return;
+        }
+
+        MeshData data;
+        if (!meshImport(objfile, data)) return;
+        if (!meshWrite(path, objfile, data)) printf("Couldn't write mesh cache entry %s\n", path.c_str());
+        mesh.bounds = data.bounds;
+        upload(mesh, data.vertices.data(), data.vertices.size() / MESH_VERTEX_FLOATS, data.indices.data(), data.indices.size());
+    }
+}
+
+GpuMesh::~GpuMesh() {
+    glDeleteVertexArrays(1, &VAO);
+    glDeleteBuffers(1, &vertexBuffer);
+    glDeleteBuffers(1, &indexBuffer);
+    //the name may come back for a new VAO, which the cache would then think is still bound
+    glState.bindVertexArray(0);
+}
+
+//GL 4.0 has no base instance, so each group re-points the instance attributes at its slice of the buffer
+void GpuMesh::pointInstances(GLuint buffer, size_t start) {
+    if (!instanceAttributes) {
+        for (int i = 0; i < 4; i++) {
+            glEnableVertexAttribArray(INSTANCE_MODEL_LOC + i);
+            glVertexAttribDivisor(INSTANCE_MODEL_LOC + i, 1);
+        }
+        instanceAttributes = true;
+    }
+    size_t base = start * sizeof(glm::mat4);
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    for (int i = 0; i < 4; i++) {
+        glVertexAttribPointer(INSTANCE_MODEL_LOC + i, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4),
+                              (const GLvoid*)(base + i*sizeof(glm::vec4)));
+    }
+}
+
+std::shared_ptr<GpuMesh> registryMesh(const std::string &objfile, bool quantized) {
+    std::weak_ptr<GpuMesh> &entry = meshes[std::make_pair(objfile, quantized)];
+    std::shared_ptr<GpuMesh> mesh = entry.lock();
+    if (!mesh) {
+        mesh = std::make_shared<GpuMesh>();
+        mesh->quantized = quantized;
+        mesh->name = objfile;
+        import(*mesh, objfile.c_str());
+        entry = mesh;
+    }
+    return mesh;
+}
+
+void registryMeshStats(size_t &count) {
+    count = 0;
+    for (const auto &m : meshes) count += !m.second.expired();
+}
@@ -0,0 +1,242 @@
+#include "options.h"
+#include "consts.h"
+#include "poster.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+Options::Options() :
+    headless(false),
+    width(WINDOW_WIDTH),
+    height(WINDOW_HEIGHT),
+    frames(0),
+    clock("wall"),
+    benchmark(false),
+    path(NULL),
+    report(NULL),
+    gpuProfile(false),
+    trace(NULL),
+    quantize(false),
+    exportPath(NULL),
+    exportFormat(NULL),
+    fps(60),
+    posterShader(NULL),
+    posterPath(NULL),
+    posterWidth(POSTER_DEFAULT_SIZE),
+    posterHeight(POSTER_DEFAULT_SIZE),
+    posterTile(POSTER_DEFAULT_TILE),
+    posterTime(0.f),
+    cpu(false),
+    threads(0),
+    compareShader(NULL),
+    tolerance(COMPARE_DEFAULT_TOLERANCE),
+    maxOutliers(COMPARE_DEFAULT_MAX_OUTLIERS),
+    frameStart(0),
+    frameEnd(0),
+    shards(0),
+    shardFrames(0),
+    shardThreads(0)
+    {}
+
+namespace {
+    void usage(const char *exe) {
+        printf("usage: %s [options]\n"
+               "  --headless [WxH]   render offscreen without a display (default %dx%d)\n"
+               "  --frames N         quit after N frames (headless defaults to %d)\n"
+               "  --clock MODE       wall (default), fixed[:STEP] (1/60 s steps) or script:FILE (a time per frame)\n"
+               "  --benchmark        fly a camera path for --frames frames (default %d) on a fixed clock and report timings\n"
+               "  --path FILE        camera path for the benchmark, x y z yaw pitch per line\n"
+               "  --report FILE      benchmark report, JSON or .csv (default JSON on stdout, the logs then go to stderr)\n"
+               "  --gpu-profile      time every draw on the GPU, print the cost leaderboard at exit\n"
+               "  --trace FILE       write a Chrome trace of the CPU zones at exit (needs make PROFILE=1)\n"
+               "  --quantize         upload meshes with 16 bit positions, half float uvs and packed normals\n"
+               "  --export FILE      render headless along the camera path and write every frame: frames/%%05d.png,\n"
+               "                     .ppm, a .y4m video or - for raw RGB on stdout (size from --headless WxH)\n"
+               "  --export-format F  png, ppm, y4m or raw, when the extension doesn't say\n"
+               "  --fps N            frame rate of the export, it steps the clock by 1/N (default 60)\n"
+               "  --poster SHADER OUT render one painting's fragment shader to a tiled .tif or a .ppm, then quit\n"
+               "  --poster-size WxH  of the poster (default %dx%d)\n"
+               "  --tile N           poster tile size, one draw each (default %d)\n"
+               "  --poster-time T    value of time the poster is rendered at (default 0)\n"
+               "  --cpu              render the poster with the painting's C++ version (cpushaders.h), no GPU needed\n"
+               "  --threads N        for the C++ paintings (default one per core)\n"
+               "  --compare SHADER   render a painting on GL and on the CPU at --headless WxH and --poster-time\n"
+               "                     and check they match\n"
+               "  --tolerance N      of 255, how far apart --compare lets a pixel be (default %d)\n"
+               "  --max-outliers F   fraction of the pixels that may be further apart than that (default %g),\n"
+               "                     only %g of them more than %d\n"
+               "  --shards N         split the export over N worker processes, rerun the same command to resume\n"
+               "  --shard-frames N   frames each worker is handed at a time (default: about 4 shards per worker)\n"
+               "  --shard-threads N  llvmpipe threads per worker (default: the cores shared out between them)\n"
+               "  --frame-range A:B  only render frames A to B-1 of the --frames (what a shard worker is given)\n",
+               exe, WINDOW_WIDTH, WINDOW_HEIGHT, HEADLESS_DEFAULT_FRAMES, BENCHMARK_DEFAULT_FRAMES,
+               POSTER_DEFAULT_SIZE, POSTER_DEFAULT_SIZE, POSTER_DEFAULT_TILE, COMPARE_DEFAULT_TOLERANCE,
+               COMPARE_DEFAULT_MAX_OUTLIERS, COMPARE_MAX_OVER_CAP, COMPARE_HARD_CAP);
+    }
+
+    bool parseSize(const char *s, int &w, int &h) {
+        return sscanf(s, "%dx%d", &w, &h) == 2 && w > 0 && h > 0;
+    }
+}
+
+bool parseOptions(int argc, char *argv[], Options &opts) {
+    bool clockGiven = false;
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        if (strcmp(arg, "--headless") == 0) {
+            opts.headless = true;
+            //the size is optional
+            if (i + 1 < argc && argv[i + 1][0] != '-') {
+                if (!parseSize(argv[++i], opts.width, opts.height)) {
+                    printf("Bad size for --headless: %s\n", argv[i]);
+                    usage(argv[0]);
+                    return false;
+                }
+            }
+        } else if (strcmp(arg, "--frames") == 0 && i + 1 < argc) {
+            char *end;
+            opts.frames = strtol(argv[++i], &end, 10);
+            if (*end || opts.frames < 0) {
+                printf("Bad frame count: %s\n", argv[i]);
+                usage(argv[0]);
+                return false;
+            }
+        } else if (strcmp(arg, "--clock") == 0 && i + 1 < argc) {
+            opts.clock = argv[++i];
+            clockGiven = true;
+        } else if (strcmp(arg, "--benchmark") == 0) {
+            opts.benchmark = true;
+        } else if (strcmp(arg, "--path") == 0 && i + 1 < argc) {
+            opts.path = argv[++i];
+        } else if (strcmp(arg, "--report") == 0 && i + 1 < argc) {
+            opts.report = argv[++i];
+        } else if (strcmp(arg, "--gpu-profile") == 0) {
+            opts.gpuProfile = true;
+        } else if (strcmp(arg, "--trace") == 0 && i + 1 < argc) {
+            opts.trace = argv[++i];
+#ifndef GENART_PROFILE
+            printf("--trace: built without PROFILE=1, there won't be anything to trace\n");
+#endif
+        } else if (strcmp(arg, "--quantize") == 0) {
+            opts.quantize = true;
+        } else if (strcmp(arg, "--export") == 0 && i + 1 < argc) {
+            opts.exportPath = argv[++i];
+        } else if (strcmp(arg, "--export-format") == 0 && i + 1 < argc) {
+            opts.exportFormat = argv[++i];
+        } else if (strcmp(arg, "--fps") == 0 && i + 1 < argc) {
+            opts.fps = atoi(argv[++i]);
+            if (opts.fps <= 0) {
+                printf("Bad frame rate: %s\n", argv[i]);
+                usage(argv[0]);
+                return false;
+            }
+        } else if (strcmp(arg, "--poster") == 0 && i + 2 < argc) {
+            opts.posterShader = argv[++i];
+            opts.posterPath = argv[++i];
+        } else if (strcmp(arg, "--poster-size") == 0 && i + 1 < argc) {
+            if (!parseSize(argv[++i], opts.posterWidth, opts.posterHeight)) {
+                printf("Bad size for --poster-size: %s\n", argv[i]);
+                usage(argv[0]);
+                return false;
+            }
+        } else if (strcmp(arg, "--tile") == 0 && i + 1 < argc) {
+            opts.posterTile = atoi(argv[++i]);
+            if (opts.posterTile <= 0) {
+                printf("Bad tile size: %s\n", argv[i]);
+                usage(argv[0]);
+                return false;
+            }
+        } else if (strcmp(arg, "--poster-time") == 0 && i + 1 < argc) {
+            opts.posterTime = atof(argv[++i]);
+        } else if (strcmp(arg, "--cpu") == 0) {
+            opts.cpu = true;
+        } else if (strcmp(arg, "--threads") == 0 && i + 1 < argc) {
+            opts.threads = atoi(argv[++i]);
+            if (opts.threads <= 0) {
+                printf("Bad thread count: %s\n", argv[i]);
+                usage(argv[0]);
+                return false;
+            }
+        } else if (strcmp(arg, "--compare") == 0 && i + 1 < argc) {
+            opts.compareShader = argv[++i];
+        } else if (strcmp(arg, "--tolerance") == 0 && i + 1 < argc) {
+            opts.tolerance = atoi(argv[++i]);
+            if (opts.tolerance < 0) {
+                printf("Bad tolerance: %s\n", argv[i]);
+                usage(argv[0]);
+                return false;
+            }
+        } else if (strcmp(arg, "--max-outliers") == 0 && i + 1 < argc) {
+            opts.maxOutliers = atof(argv[++i]);
+            if (opts.maxOutliers < 0. || opts.maxOutliers > 1.) {
+                printf("Bad outlier fraction: %s\n", argv[i]);
+                usage(argv[0]);
+                return false;
+            }
+        } else if (strcmp(arg, "--shards") == 0 && i + 1 < argc) {
+            opts.shards = atoi(argv[++i]);
+            if (opts.shards <= 0) {
+                printf("Bad shard count: %s\n", argv[i]);
+                usage(argv[0]);
+                return false;
+            }
+        } else if (strcmp(arg, "--shard-frames") == 0 && i + 1 < argc) {
+            opts.shardFrames = atol(argv[++i]);
+            if (opts.shardFrames <= 0) {
+                printf("Bad shard size: %s\n", argv[i]);
+                usage(argv[0]);
+                return false;
+            }
+        } else if (strcmp(arg, "--shard-threads") == 0 && i + 1 < argc) {
+            opts.shardThreads = atoi(argv[++i]);
+            if (opts.shardThreads <= 0) {
+                printf("Bad thread count: %s\n", argv[i]);
+                usage(argv[0]);
+                return false;
+            }
+        } else if (strcmp(arg, "--frame-range") == 0 && i + 1 < argc) {
+            char end;
+            if (sscanf(argv[++i], "%ld:%ld%c", &opts.frameStart, &opts.frameEnd, &end) != 2
+                || opts.frameStart < 0 || opts.frameEnd <= opts.frameStart) {
+                printf("Bad frame range: %s\n", argv[i]);
+                usage(argv[0]);
+                return false;
+            }
+        } else if (strcmp(arg, "--help") == 0 || strcmp(arg, "-h") == 0) {
+            usage(argv[0]);
+            return false;
+        } else {
+            printf("Unknown option: %s\n", arg);
+            usage(argv[0]);
+            return false;
+        }
+    }
+    //comparable runs need the same frames, so the benchmark steps time unless told otherwise
+    if (opts.benchmark) {
+        if (opts.frames == 0) opts.frames = BENCHMARK_DEFAULT_FRAMES;
+        if (!clockGiven) opts.clock = "fixed";
+    }
+    //exports render offscreen at whatever size, one clock step per video frame
+    if (opts.exportPath) {
+        static char exportClock[32];
+        opts.headless = true;
+        if (!clockGiven) {
+            snprintf(exportClock, sizeof(exportClock), "fixed:%.9f", 1.0 / opts.fps);
+            opts.clock = exportClock;
+        }
+    }
+    //a poster needs a context, not a window
+    if (opts.posterShader || opts.compareShader) opts.headless = true;
+    //nobody can close a window that doesn't exist
+    if (opts.headless && opts.frames == 0) opts.frames = HEADLESS_DEFAULT_FRAMES;
+    if (opts.frameEnd == 0) opts.frameEnd = opts.frames;
+    if (opts.frameEnd > opts.frames) {
+        printf("Frame range %ld:%ld is past the %ld frames\n", opts.frameStart, opts.frameEnd, opts.frames);
+        return false;
+    }
+    if (opts.shards > 0 && (!opts.exportPath || strcmp(opts.exportPath, "-") == 0)) {
+        printf("--shards splits an --export, to a file\n");
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,43 @@
+#include "painting.h"
+#include "consts.h"
+#include "renderstats.h"
+#include "glstate.h"
+
+shader_prog *Painting::placeholder = NULL;
+uniform_handle Painting::placeholderModelLoc;
+shader_prog *Painting::depthshader = NULL;
+uniform_handle Painting::depthModelLoc;
+
+glm::mat4 Painting::modelMatrix() const {
+    glm::mat4 model = glm::translate(glm::mat4(1.0), position);
+    return glm::rotate(model, glm::radians(angle), glm::vec3(0., 1., 0.));
+}
+
+//world space sphere around the quad, whatever way it's turned
+BoundingSphere Painting::bounds() const {
+    return BoundingSphere{position, PAINTING_SIZE * 1.41422f};
+}
+
+//plain grey quad (the VAO's vertex colour) in the painting's place
+void Painting::renderPlaceholder(GLuint VAO) {
+    if (!placeholder) return;
+    placeholder->begin();
+    placeholder->uniformMatrix4fv(placeholderModelLoc, modelMatrix());
+    glState.enable(GL_CULL_FACE, true);
+    glState.bindVertexArray(VAO);
+    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_BYTE, 0);
+    renderStats.drawCalls++;
+    placeholder->end();
+}
+
+//same quad, depth only; the same for placeholders since they share the vertex shader
+void Painting::renderDepth(GLuint VAO) {
+    if (!depthshader) return;
+    depthshader->begin();
+    depthshader->uniformMatrix4fv(depthModelLoc, modelMatrix());
+    glState.enable(GL_CULL_FACE, true);
+    glState.bindVertexArray(VAO);
+    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_BYTE, 0);
+    renderStats.drawCalls++;
+    depthshader->end();
+}
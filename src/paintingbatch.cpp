@@ -0,0 +1,127 @@
+#include "paintingbatch.h"
+#include "consts.h"
+#include "renderqueue.h"
+#include "renderstats.h"
+#include "glstate.h"
+#include <algorithm>
+#include <cstddef>
+
+PaintingBatch::PaintingBatch() :
+    VAO(0),
+    instanceVBO(0),
+    capacity(0),
+    depthshader("shaders/basic.vert.glsl", "shaders/depth.frag.glsl", "#define INSTANCED")
+    {}
+
+void PaintingBatch::init(GLuint quadVAO) {
+    //borrow the buffers createQuad made, the layout is the same 8 floats per vertex
+    GLint quadVBO, quadIBO;
+    glState.bindVertexArray(quadVAO);
+    glGetVertexAttribiv(VERTEX_POSITION_LOC, GL_VERTEX_ATTRIB_ARRAY_BUFFER_BINDING, &quadVBO);
+    glGetIntegerv(GL_ELEMENT_ARRAY_BUFFER_BINDING, &quadIBO);
+
+    glGenVertexArrays(1, &VAO);
+    glState.bindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
+    glEnableVertexAttribArray(VERTEX_POSITION_LOC);
+    glVertexAttribPointer(VERTEX_POSITION_LOC, 3, GL_FLOAT, GL_FALSE, 8*sizeof(float), (const GLvoid*)(0*sizeof(float)));
+    glEnableVertexAttribArray(COLOR_LOC);
+    glVertexAttribPointer(COLOR_LOC, 3, GL_FLOAT, GL_FALSE, 8*sizeof(float), (const GLvoid*)(3*sizeof(float)));
+    glEnableVertexAttribArray(UV_LOC);
+    glVertexAttribPointer(UV_LOC, 2, GL_FLOAT, GL_FALSE, 8*sizeof(float), (const GLvoid*)(6*sizeof(float)));
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, quadIBO);
+
+    glGenBuffers(1, &instanceVBO);
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    for (int i = 0; i < 5; i++) {
+        //INSTANCE_MODEL_LOC..+3 are the matrix columns, INSTANCE_PARAMS_LOC comes right after
+        glEnableVertexAttribArray(INSTANCE_MODEL_LOC + i);
+        glVertexAttribDivisor(INSTANCE_MODEL_LOC + i, 1);
+    }
+    pointInstanceAttributes(0);
+
+    depthshader.submit();
+}
+
+//GL 4.0 has no base instance, so each group re-points the instance attributes at its slice of the buffer
+void PaintingBatch::pointInstanceAttributes(size_t start) {
+    const GLsizei stride = sizeof(PaintingInstance);
+    size_t base = start * sizeof(PaintingInstance);
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    for (int i = 0; i < 4; i++) {
+        glVertexAttribPointer(INSTANCE_MODEL_LOC + i, 4, GL_FLOAT, GL_FALSE, stride,
+                              (const GLvoid*)(base + i*sizeof(glm::vec4)));
+    }
+    glVertexAttribPointer(INSTANCE_PARAMS_LOC, 4, GL_FLOAT, GL_FALSE, stride,
+                          (const GLvoid*)(base + offsetof(PaintingInstance, params)));
+}
+
+void PaintingBatch::clear() {
+    queued.clear();
+}
+
+void PaintingBatch::add(Painting *p) {
+    queued.push_back(Queued{p, 0.f});
+}
+
+void PaintingBatch::build(const glm::mat4 &view) {
+    instances.clear();
+    groups.clear();
+    if (queued.empty()) return;
+
+    //group by program, nearest first inside a group
+    for (Queued &q : queued) {
+        q.depth = viewDepth(view, q.painting->position);
+    }
+    std::sort(queued.begin(), queued.end(), [](const Queued &a, const Queued &b) {
+        GLuint pa = a.painting->pshader, pb = b.painting->pshader;
+        if (pa != pb) return pa < pb;
+        return a.depth < b.depth;
+    });
+    for (const Queued &q : queued) {
+        GLuint program = q.painting->pshader;
+        if (groups.empty() || groups.back().program != program) {
+            groups.push_back(Group{q.painting, program, instances.size(), 0, q.depth});
+        }
+        groups.back().count++;
+        instances.push_back(PaintingInstance{q.painting->modelMatrix(), q.painting->params});
+    }
+
+    //orphan and refill the whole instance buffer once per frame
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    if (instances.size() > capacity) {
+        capacity = std::max(instances.size(), capacity * 2);
+    }
+    glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(PaintingInstance), NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, instances.size() * sizeof(PaintingInstance), &instances[0]);
+}
+
+void PaintingBatch::drawGroup(size_t i) {
+    const Group &g = groups[i];
+    g.first->pshader.begin();
+    glState.enable(GL_CULL_FACE, true);
+    glState.bindVertexArray(VAO);
+    pointInstanceAttributes(g.start);
+    glDrawElementsInstanced(GL_TRIANGLES, 6, GL_UNSIGNED_BYTE, 0, g.count);
+    renderStats.drawCalls++;
+    g.first->pshader.end();
+}
+
+//same instances through the depth-only program; nothing until it has compiled
+void PaintingBatch::drawGroupDepth(size_t i) {
+    if (!depthshader.poll()) return;
+    const Group &g = groups[i];
+    depthshader.begin();
+    glState.enable(GL_CULL_FACE, true);
+    glState.bindVertexArray(VAO);
+    pointInstanceAttributes(g.start);
+    glDrawElementsInstanced(GL_TRIANGLES, 6, GL_UNSIGNED_BYTE, 0, g.count);
+    renderStats.drawCalls++;
+    depthshader.end();
+}
+
+void PaintingBatch::draw() {
+    for (size_t i = 0; i < groups.size(); i++) {
+        drawGroup(i);
+    }
+}
@@ -0,0 +1,154 @@
+#include "paintingcache.h"
+#include "consts.h"
+#include "renderstats.h"
+#include "glstate.h"
+#include <algorithm>
+
+PaintingCache::PaintingCache() :
+    cachedshader("shaders/basic.vert.glsl", "shaders/cached.frag.glsl"),
+    captureUBO(0),
+    pixelBudget(1024 * 1024),
+    minSize(32),
+    maxSize(1024)
+    {}
+
+void PaintingCache::init() {
+    cachedshader.setup();
+    modelLoc = cachedshader.handle("modelMatrix");
+    cachedshader.begin();
+    cachedshader.uniform1i("painting", 0);
+    cachedshader.end();
+
+    glGenBuffers(1, &captureUBO);
+    glBindBuffer(GL_UNIFORM_BUFFER, captureUBO);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameGlobals), NULL, GL_STREAM_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void PaintingCache::add(Painting *p) {
+    Entry e = {p, 0, 0, 0, 0, 0, false};
+    glGenFramebuffers(1, &e.fbo);
+    glGenTextures(1, &e.tex);
+    entries.push_back(e);
+}
+
+void PaintingCache::resize(Entry &e, int size) {
+    glState.bindTexture(0, e.tex);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, size, size, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindFramebuffer(GL_FRAMEBUFFER, e.fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, e.tex, 0);
+    e.size = size;
+    e.valid = false;
+}
+
+//rough on-screen footprint of the painting quad in pixels (its longest side), 0 if it can't be seen
+int PaintingCache::screenSize(const Painting &p, const FrameGlobals &frame, glm::ivec2 viewport) const {
+    glm::mat4 mvp = frame.viewProjection * p.modelMatrix();
+    glm::vec2 lo(1.f), hi(-1.f);
+    int left = 0, right = 0, below = 0, above = 0, behind = 0;
+    for (int i = 0; i < 4; i++) {
+        glm::vec4 c = mvp * glm::vec4((i & 1) ? PAINTING_SIZE : -PAINTING_SIZE, (i & 2) ? PAINTING_SIZE : -PAINTING_SIZE, 0.f, 1.f);
+        if (c.w <= 0.f) { behind++; continue; }
+        glm::vec2 ndc = glm::vec2(c) / c.w;
+        left += ndc.x < -1.f; right += ndc.x > 1.f;
+        below += ndc.y < -1.f; above += ndc.y > 1.f;
+        lo = glm::min(lo, glm::clamp(ndc, -1.f, 1.f));
+        hi = glm::max(hi, glm::clamp(ndc, -1.f, 1.f));
+    }
+    if (behind == 4 || left == 4 || right == 4 || below == 4 || above == 4) return 0;
+    //crossing the camera plane: it's right in front of us, give it everything
+    if (behind > 0) return maxSize;
+    glm::vec2 extent = (hi - lo) * 0.5f * glm::vec2(viewport);
+    return (int)std::max(extent.x, extent.y);
+}
+
+void PaintingCache::refresh(Entry &e, GLuint VAO, const FrameGlobals &frame) {
+    //same frame values, but a camera looking straight at the painting so its quad fills the texture
+    FrameGlobals capture = frame;
+    capture.view = glm::inverse(e.painting->modelMatrix());
+    capture.projection = glm::ortho(-PAINTING_SIZE, PAINTING_SIZE, -PAINTING_SIZE, PAINTING_SIZE, -1.f, 1.f);
+    capture.viewProjection = capture.projection * capture.view;
+    capture.resolution = glm::vec2(e.size);
+    glBindBuffer(GL_UNIFORM_BUFFER, captureUBO);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameGlobals), &capture);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, e.fbo);
+    glViewport(0, 0, e.size, e.size);
+    e.painting->render(VAO);
+
+    glState.bindTexture(0, e.tex);
+    glGenerateMipmap(GL_TEXTURE_2D);
+    e.age = 0;
+    e.valid = true;
+}
+
+void PaintingCache::update(GLuint VAO, const FrameUniforms &frame, glm::ivec2 viewport) {
+    //whatever the frame is drawn into (the window, or the headless framebuffer), to go back to
+    GLint target = 0;
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &target);
+    std::vector<Entry*> candidates;
+    for (Entry &e : entries) {
+        e.age++;
+        int footprint = screenSize(*e.painting, frame.current(), viewport);
+        e.wanted = 0;
+        if (footprint == 0 || !e.painting->ready()) continue;
+
+        int wanted = minSize;
+        while (wanted < footprint && wanted < maxSize) wanted *= 2;
+        e.wanted = wanted;
+        //grow right away, but only shrink once it's far too big, so walking around doesn't thrash
+        if (e.size == 0 || wanted > e.size || wanted * 4 <= e.size) resize(e, wanted);
+        candidates.push_back(&e);
+    }
+    if (candidates.empty()) {
+        glBindFramebuffer(GL_FRAMEBUFFER, target);
+        return;
+    }
+
+    //never rendered first, then whatever has waited longest relative to how much screen it covers
+    std::sort(candidates.begin(), candidates.end(), [](const Entry *a, const Entry *b) {
+        if (a->valid != b->valid) return !a->valid;
+        return (double)a->age * a->wanted * a->wanted > (double)b->age * b->wanted * b->wanted;
+    });
+
+    glState.bindUniformBuffer(FRAME_GLOBALS_BINDING, captureUBO);
+    glState.enable(GL_DEPTH_TEST, false);
+    long spent = 0;
+    for (Entry *e : candidates) {
+        long cost = (long)e->size * e->size;
+        if (spent > 0 && spent + cost > pixelBudget) continue;
+        refresh(*e, VAO, frame.current());
+        spent += cost;
+    }
+    glState.enable(GL_DEPTH_TEST, true);
+    glState.bindUniformBuffer(FRAME_GLOBALS_BINDING, frame.buffer());
+    glBindFramebuffer(GL_FRAMEBUFFER, target);
+    glViewport(0, 0, viewport.x, viewport.y);
+}
+
+void PaintingCache::draw(GLuint VAO, const Frustum &frustum) {
+    cachedshader.begin();
+    glState.enable(GL_CULL_FACE, true);
+    glState.bindVertexArray(VAO);
+    for (Entry &e : entries) {
+        if (!frustum.intersects(e.painting->bounds())) {
+            renderStats.culled++;
+            continue;
+        }
+        renderStats.drawn++;
+        if (!e.valid) continue;
+        glState.bindTexture(0, e.tex);
+        cachedshader.uniformMatrix4fv(modelLoc, e.painting->modelMatrix());
+        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_BYTE, 0);
+        renderStats.drawCalls++;
+    }
+    cachedshader.end();
+    for (Entry &e : entries) {
+        if (!e.valid && frustum.intersects(e.painting->bounds())) e.painting->renderPlaceholder(VAO);
+    }
+}
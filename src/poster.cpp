@@ -0,0 +1,359 @@
+#include "poster.h"
+#include "shader_util.h"
+#include "consts.h"
+#include "glstate.h"
+#include "renderstats.h"
+#include "profiler.h"
+#include "cpushaders.h"
+#include "threadpool.h"
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+namespace {
+#ifdef _WIN32
+    int seek(FILE *f, uint64_t offset) { return _fseeki64(f, offset, SEEK_SET); }
+#else
+    int seek(FILE *f, uint64_t offset) { return fseeko(f, offset, SEEK_SET); }
+#endif
+
+    //takes finished tiles (top-down RGB, tile x tile, clipped at the right and bottom edges) in any order
+    class PosterWriter {
+        private:
+            bool tiff, big;
+            FILE *f;
+            int width, height, tile, across, down;
+            uint64_t headerSize, tileBytes;
+
+            void put(std::vector<unsigned char> &out, uint64_t v, int bytes) {
+                for (int i = 0; i < bytes; i++) out.push_back((v >> (8 * i)) & 0xFF);
+            }
+            //TIFF IFD entry; values that don't fit the entry go to extra, which starts at extraOffset in the file
+            void entry(std::vector<unsigned char> &ifd, std::vector<unsigned char> &extra, uint64_t extraOffset,
+                       int tag, int type, const std::vector<uint64_t> &values) {
+                int size = type == 3 ? 2 : type == 4 ? 4 : 8;
+                int inlineBytes = big ? 8 : 4;
+                put(ifd, tag, 2);
+                put(ifd, type, 2);
+                put(ifd, values.size(), big ? 8 : 4);
+                std::vector<unsigned char> data;
+                for (uint64_t v : values) put(data, v, size);
+                if ((int)data.size() <= inlineBytes) {
+                    data.resize(inlineBytes, 0);
+                    ifd.insert(ifd.end(), data.begin(), data.end());
+                } else {
+                    put(ifd, extraOffset + extra.size(), inlineBytes);
+                    extra.insert(extra.end(), data.begin(), data.end());
+                    if (extra.size() & 1) extra.push_back(0);
+                }
+            }
+        public:
+            PosterWriter() : f(NULL) {}
+
+            bool open(const std::string &path, int w, int h, int t) {
+                width = w;
+                height = h;
+                tile = t;
+                across = (w + t - 1) / t;
+                down = (h + t - 1) / t;
+                std::string ext = path.substr(path.rfind('.') == std::string::npos ? path.size() : path.rfind('.'));
+                tiff = ext == ".tif" || ext == ".tiff";
+                if (!tiff && ext != ".ppm") {
+                    printf("Poster: %s should be a .tif, .tiff or .ppm\n", path.c_str());
+                    return false;
+                }
+                f = fopen(path.c_str(), "wb");
+                if (!f) {
+                    printf("Poster: can't open %s\n", path.c_str());
+                    return false;
+                }
+                if (tiff) {
+                    //whole tiles, the ones over the edges are padded
+                    tileBytes = (uint64_t)t * t * 3;
+                    big = tileBytes * across * down + (1 << 20) > 0xFFFFFFFFull;
+                    headerSize = big ? 16 : 8;
+                    std::vector<unsigned char> header;
+                    header.push_back('I');
+                    header.push_back('I');
+                    put(header, big ? 43 : 42, 2);
+                    if (big) {
+                        put(header, 8, 2);
+                        put(header, 0, 2);
+                    }
+                    //IFD offset, filled in by close()
+                    put(header, 0, big ? 8 : 4);
+                    fwrite(header.data(), 1, header.size(), f);
+                } else {
+                    char header[64];
+                    headerSize = snprintf(header, sizeof(header), "P6\n%d %d\n255\n", w, h);
+                    fwrite(header, 1, headerSize, f);
+                }
+                return true;
+            }
+
+            bool write(int tx, int ty, const unsigned char *rgb) {
+                if (tiff) {
+                    uint64_t index = (uint64_t)ty * across + tx;
+                    return seek(f, headerSize + index * tileBytes) == 0
+                           && fwrite(rgb, 1, tileBytes, f) == tileBytes;
+                }
+                //straight into the rows of the image it belongs to
+                int x0 = tx * tile, w = std::min(tile, width - x0);
+                for (int y = 0; y < tile && ty * tile + y < height; y++) {
+                    uint64_t at = headerSize + ((uint64_t)(ty * tile + y) * width + x0) * 3;
+                    if (seek(f, at) != 0 || fwrite(rgb + (size_t)y * tile * 3, 1, w * 3, f) != (size_t)w * 3) return false;
+                }
+                return true;
+            }
+
+            bool close() {
+                bool ok = true;
+                if (tiff) {
+                    uint64_t ifdOffset = headerSize + tileBytes * across * down;
+                    int entries = 11;
+                    uint64_t ifdSize = (big ? 8 : 2) + entries * (big ? 20 : 12) + (big ? 8 : 4);
+                    uint64_t extraOffset = ifdOffset + ifdSize;
+                    std::vector<unsigned char> ifd, extra;
+                    std::vector<uint64_t> offsets, counts;
+                    for (int i = 0; i < across * down; i++) {
+                        offsets.push_back(headerSize + i * tileBytes);
+                        counts.push_back(tileBytes);
+                    }
+                    int longType = big ? 16 : 4;
+                    put(ifd, entries, big ? 8 : 2);
+                    entry(ifd, extra, extraOffset, 256, 4, {(uint64_t)width});          //ImageWidth
+                    entry(ifd, extra, extraOffset, 257, 4, {(uint64_t)height});         //ImageLength
+                    entry(ifd, extra, extraOffset, 258, 3, {8, 8, 8});                  //BitsPerSample
+                    entry(ifd, extra, extraOffset, 259, 3, {1});                        //Compression: none
+                    entry(ifd, extra, extraOffset, 262, 3, {2});                        //PhotometricInterpretation: RGB
+                    entry(ifd, extra, extraOffset, 277, 3, {3});                        //SamplesPerPixel
+                    entry(ifd, extra, extraOffset, 284, 3, {1});                        //PlanarConfiguration: chunky
+                    entry(ifd, extra, extraOffset, 322, 4, {(uint64_t)tile});           //TileWidth
+                    entry(ifd, extra, extraOffset, 323, 4, {(uint64_t)tile});           //TileLength
+                    entry(ifd, extra, extraOffset, 324, longType, offsets);             //TileOffsets
+                    entry(ifd, extra, extraOffset, 325, longType, counts);              //TileByteCounts
+                    put(ifd, 0, big ? 8 : 4);       //no next IFD
+                    std::vector<unsigned char> at;
+                    put(at, ifdOffset, big ? 8 : 4);
+                    ok = seek(f, ifdOffset) == 0
+                         && fwrite(ifd.data(), 1, ifd.size(), f) == ifd.size()
+                         && fwrite(extra.data(), 1, extra.size(), f) == extra.size()
+                         && seek(f, big ? 8 : 4) == 0
+                         && fwrite(at.data(), 1, at.size(), f) == at.size();
+                }
+                if (fclose(f) != 0) ok = false;
+                f = NULL;
+                return ok;
+            }
+    };
+
+    //the quad over a w x h viewport of the bound framebuffer, showing the uvRect part of the painting
+    void drawPart(shader_prog &shader, uniform_handle uvRectLoc, GLuint quadVAO, int w, int h, glm::vec4 uvRect) {
+        glViewport(0, 0, w, h);
+        glState.enable(GL_DEPTH_TEST, false);
+        glState.enable(GL_CULL_FACE, false);
+        shader.begin();
+        shader.uniform4f(uvRectLoc, uvRect.x, uvRect.y, uvRect.z, uvRect.w);
+        //INSTANCED program, VAO without instance arrays: the current values are what it reads
+        glm::mat4 identity(1.f);
+        for (int c = 0; c < 4; c++) {
+            glVertexAttrib4fv(INSTANCE_MODEL_LOC + c, glm::value_ptr(identity[c]));
+        }
+        glVertexAttrib4f(INSTANCE_PARAMS_LOC, 0.f, 0.f, 0.f, 0.f);
+        glState.bindVertexArray(quadVAO);
+        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_BYTE, 0);
+        renderStats.drawCalls++;
+        shader.end();
+    }
+
+    //w x h RGBA to RGB, bottom-up (as GL reads them) to top-down if flip
+    void toRGB(const unsigned char *rgba, int w, int h, bool flip, unsigned char *rgb) {
+        for (int y = 0; y < h; y++) {
+            const unsigned char *src = rgba + (size_t)(flip ? h - 1 - y : y) * w * 4;
+            unsigned char *dst = rgb + (size_t)y * w * 3;
+            for (int x = 0; x < w; x++) {
+                dst[x * 3] = src[x * 4];
+                dst[x * 3 + 1] = src[x * 4 + 1];
+                dst[x * 3 + 2] = src[x * 4 + 2];
+            }
+        }
+    }
+
+    bool compileTiled(shader_prog &shader, const char *fshader) {
+        shader.setup();
+        if (!shader.is_ready()) {
+            printf("Poster: %s didn't compile\n", fshader);
+            return false;
+        }
+        return true;
+    }
+}
+
+bool renderPoster(const char *fshader, const char *outfile, int width, int height, int tile, GLuint quadVAO) {
+    PROFILE_ZONE("renderPoster");
+    //TIFF wants tiles in multiples of 16, and GL has its own limits
+    GLint maxRenderbuffer = 0, maxViewport[2] = {0, 0};
+    glGetIntegerv(GL_MAX_RENDERBUFFER_SIZE, &maxRenderbuffer);
+    glGetIntegerv(GL_MAX_VIEWPORT_DIMS, maxViewport);
+    tile = std::min(tile, std::min((int)maxRenderbuffer, std::min(maxViewport[0], maxViewport[1])));
+    tile = std::max(16, tile / 16 * 16);
+
+    shader_prog shader("shaders/basic.vert.glsl", fshader, "#define INSTANCED\n#define TILED");
+    if (!compileTiled(shader, fshader)) return false;
+    //optimized out of paintings that never read fraguv
+    uniform_handle uvRectLoc = shader.try_handle("uvRect");
+
+    PosterWriter writer;
+    if (!writer.open(outfile, width, height, tile)) return false;
+
+    GLint previous;
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previous);
+    GLuint fbo, color, pbo[2];
+    glGenRenderbuffers(1, &color);
+    glBindRenderbuffer(GL_RENDERBUFFER, color);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, tile, tile);
+    glGenFramebuffers(1, &fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color);
+    size_t tileBytes = (size_t)tile * tile * 4;
+    glGenBuffers(2, pbo);
+    for (int i = 0; i < 2; i++) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo[i]);
+        glBufferData(GL_PIXEL_PACK_BUFFER, tileBytes, NULL, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    int across = (width + tile - 1) / tile, down = (height + tile - 1) / tile, count = across * down;
+    printf("Poster: %s at %dx%d in %d tiles of %d to %s\n", fshader, width, height, count, tile, outfile);
+
+    //each tile is read back into one PBO while the one before it comes out of the other and goes to disk
+    std::vector<unsigned char> rgb((size_t)tile * tile * 3);
+    bool ok = true;
+    for (int i = 0; i <= count && ok; i++) {
+        if (i < count) {
+            PROFILE_ZONE("poster tile");
+            int tx = i % across, ty = i / across;
+            drawPart(shader, uvRectLoc, quadVAO, tile, tile, glm::vec4((float)tx * tile / width, (float)ty * tile / height,
+                                                                       (float)tile / width, (float)tile / height));
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo[i & 1]);
+            glReadPixels(0, 0, tile, tile, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+            //hand it to the driver now, so every tile is a submission of its own
+            glFlush();
+        }
+        if (i > 0) {
+            PROFILE_ZONE("poster write");
+            int prev = i - 1;
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo[prev & 1]);
+            const unsigned char *rgba = (const unsigned char *)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, tileBytes, GL_MAP_READ_BIT);
+            if (rgba) toRGB(rgba, tile, tile, true, rgb.data());
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+            ok = rgba && writer.write(prev % across, prev / across, rgb.data());
+            if (!ok) printf("Poster: writing tile %d failed\n", prev);
+            else if ((prev + 1) % across == 0) printf("Poster: %d/%d tile rows\n", (prev + 1) / across, down);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+    if (!writer.close()) ok = false;
+
+    glBindFramebuffer(GL_FRAMEBUFFER, previous);
+    glDeleteFramebuffers(1, &fbo);
+    glDeleteRenderbuffers(1, &color);
+    glDeleteBuffers(2, pbo);
+    shader.free();
+    return ok;
+}
+
+bool renderCpuPoster(const char *fshader, const char *outfile, int width, int height, int tile, float time, int threads) {
+    PROFILE_ZONE("renderCpuPoster");
+    CpuShader shader = cpuShader(fshader);
+    if (!shader) {
+        printf("Poster: %s has no CPU version (see cpushaders.h)\n", fshader);
+        return false;
+    }
+    tile = std::max(16, tile / 16 * 16);
+    PosterWriter writer;
+    if (!writer.open(outfile, width, height, tile)) return false;
+
+    ThreadPool pool(threads);
+    int across = (width + tile - 1) / tile, down = (height + tile - 1) / tile, count = across * down;
+    printf("Poster: %s at %dx%d in %d tiles of %d to %s, on %d threads %d pixels at a time\n",
+           fshader, width, height, count, tile, outfile, pool.size(), SIMD_WIDTH);
+    std::vector<unsigned char> rgba((size_t)tile * tile * 4), rgb((size_t)tile * tile * 3);
+    bool ok = true;
+    for (int i = 0; i < count && ok; i++) {
+        int tx = i % across, ty = i / across;
+        cpuShade(pool, shader, time, width, height, tx * tile, ty * tile, tile, tile, rgba.data(), tile * 4);
+        toRGB(rgba.data(), tile, tile, false, rgb.data());
+        ok = writer.write(tx, ty, rgb.data());
+        if (!ok) printf("Poster: writing tile %d failed\n", i);
+        else if ((i + 1) % across == 0) printf("Poster: %d/%d tile rows\n", (i + 1) / across, down);
+    }
+    if (!writer.close()) ok = false;
+    return ok;
+}
+
+bool comparePainting(const char *fshader, int width, int height, float time, int tolerance, double maxOutliers,
+                     int threads, GLuint quadVAO) {
+    PROFILE_ZONE("comparePainting");
+    CpuShader cpu = cpuShader(fshader);
+    if (!cpu) {
+        printf("Compare: %s has no CPU version (see cpushaders.h)\n", fshader);
+        return false;
+    }
+    shader_prog shader("shaders/basic.vert.glsl", fshader, "#define INSTANCED\n#define TILED");
+    if (!compileTiled(shader, fshader)) return false;
+
+    //the whole painting as a single tile
+    GLint previous;
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previous);
+    GLuint fbo, color;
+    glGenRenderbuffers(1, &color);
+    glBindRenderbuffer(GL_RENDERBUFFER, color);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glGenFramebuffers(1, &fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color);
+    drawPart(shader, shader.try_handle("uvRect"), quadVAO, width, height, glm::vec4(0.f, 0.f, 1.f, 1.f));
+    std::vector<unsigned char> gl((size_t)width * height * 4), gpu((size_t)width * height * 3);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, gl.data());
+    glBindFramebuffer(GL_FRAMEBUFFER, previous);
+    glDeleteFramebuffers(1, &fbo);
+    glDeleteRenderbuffers(1, &color);
+    shader.free();
+    toRGB(gl.data(), width, height, true, gpu.data());
+
+    ThreadPool pool(threads);
+    std::vector<unsigned char> rgba((size_t)width * height * 4), ref((size_t)width * height * 3);
+    auto started = std::chrono::steady_clock::now();
+    cpuShade(pool, cpu, time, width, height, 0, 0, width, height, rgba.data(), width * 4);
+    double cpuTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    toRGB(rgba.data(), width, height, false, ref.data());
+
+    //per pixel, the channel furthest off
+    int worst = 0;
+    long outliers = 0, overCap = 0;
+    double total = 0.;
+    for (size_t p = 0; p < ref.size(); p += 3) {
+        int d = 0;
+        for (int c = 0; c < 3; c++) d = std::max(d, std::abs((int)gpu[p + c] - (int)ref[p + c]));
+        worst = std::max(worst, d);
+        total += d;
+        if (d > tolerance) outliers++;
+        if (d > COMPARE_HARD_CAP) overCap++;
+    }
+    long pixels = (long)width * height;
+    bool ok = outliers <= pixels * maxOutliers && overCap <= pixels * COMPARE_MAX_OVER_CAP;
+    printf("Compare: %s at %dx%d, time %g: max difference %d, mean %.3f, %ld pixels (%.3f%%) over %d, "
+           "%ld (%.3f%%) over %d, %s\n",
+           fshader, width, height, time, worst, total / pixels, outliers, 100. * outliers / pixels, tolerance,
+           overCap, 100. * overCap / pixels, COMPARE_HARD_CAP, ok ? "match" : "MISMATCH");
+    printf("Compare: CPU version took %.1f ms on %d threads, %d pixels at a time\n", cpuTime * 1000., pool.size(), SIMD_WIDTH);
+    return ok;
+}
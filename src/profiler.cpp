@@ -0,0 +1,110 @@
+#include "profiler.h"
+
+#ifdef GENART_PROFILE
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace {
+    struct ProfileEvent {
+        const char *name;
+        int64_t start, end;     //ns since startup
+    };
+
+    struct ThreadBuffer {
+        ProfileEvent events[PROFILE_RING_SIZE];
+        std::atomic<uint64_t> written;  //total ever, the ring holds the last PROFILE_RING_SIZE
+        std::string name;
+        int tid;
+        ThreadBuffer() : written(0), tid(0) {}
+    };
+
+    //only touched when a thread records its first zone and when exporting
+    std::mutex buffersMutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+    const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+
+    //buffers outlive their threads, so a trace written at exit still has the loader thread in it
+    ThreadBuffer *threadBuffer() {
+        thread_local ThreadBuffer *buffer = NULL;
+        if (!buffer) {
+            std::lock_guard<std::mutex> lock(buffersMutex);
+            buffers.emplace_back(new ThreadBuffer());
+            buffer = buffers.back().get();
+            buffer->tid = buffers.size();
+            buffer->name = "thread " + std::to_string(buffer->tid);
+        }
+        return buffer;
+    }
+
+    int64_t now() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+    }
+
+    void writeString(FILE *out, const char *s) {
+        fputc('"', out);
+        for (; *s; s++) {
+            if (*s == '"' || *s == '\\') fputc('\\', out);
+            if ((unsigned char)*s >= 0x20) fputc(*s, out);
+        }
+        fputc('"', out);
+    }
+}
+
+ProfileZone::ProfileZone(const char *name) :
+    name(name),
+    start(now())
+    {}
+
+ProfileZone::~ProfileZone() {
+    ThreadBuffer *b = threadBuffer();
+    uint64_t n = b->written.load(std::memory_order_relaxed);
+    b->events[n % PROFILE_RING_SIZE] = ProfileEvent{name, start, now()};
+    b->written.store(n + 1, std::memory_order_release);
+}
+
+void profileThreadName(const char *name) {
+    threadBuffer()->name = name;
+}
+
+bool profileWriteTrace(const char *filename) {
+    FILE *out = fopen(filename, "w");
+    if (!out) {
+        printf("Can't write trace %s\n", filename);
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(buffersMutex);
+    size_t count = 0;
+    fprintf(out, "{\"traceEvents\":[\n");
+    bool first = true;
+    for (const auto &b : buffers) {
+        fprintf(out, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":", first ? "" : ",\n", b->tid);
+        writeString(out, b->name.c_str());
+        fprintf(out, "}}");
+        first = false;
+
+        //a thread still running may overwrite the oldest events as we go, that's fine for a trace
+        uint64_t written = b->written.load(std::memory_order_acquire);
+        uint64_t begin = written > PROFILE_RING_SIZE ? written - PROFILE_RING_SIZE : 0;
+        for (uint64_t i = begin; i < written; i++) {
+            const ProfileEvent &e = b->events[i % PROFILE_RING_SIZE];
+            fprintf(out, ",\n{\"name\":");
+            writeString(out, e.name);
+            //trace_event wants microseconds
+            fprintf(out, ",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                    b->tid, e.start / 1000.0, (e.end - e.start) / 1000.0);
+            count++;
+        }
+    }
+    fprintf(out, "\n]}\n");
+    fclose(out);
+    printf("Wrote %zu zones to %s\n", count, filename);
+    return true;
+}
+
+#endif
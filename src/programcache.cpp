@@ -0,0 +1,117 @@
+#include "programcache.h"
+#include "fileutil.h"
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <fstream>
+
+namespace {
+    const char magic[4] = {'G', 'A', 'P', 'B'};
+    const unsigned int format_version = 1;
+
+    struct cache_header {
+        char magic[4];
+        unsigned int version;
+        GLenum binary_format;
+        unsigned int length;
+        char key[17];
+    };
+
+    std::string entry_path(const std::string& key) {
+        return std::string(PROGRAM_CACHE_DIR) + "/" + key + ".bin";
+    }
+
+    std::string gl_string(GLenum name) {
+        const GLubyte* s = glGetString(name);
+        return s ? std::string((const char*)s) : std::string();
+    }
+}
+
+unsigned long long source_hash(const std::string& data, unsigned long long hash) {
+    for (unsigned char c : data) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+bool program_cache_available() {
+    static int available = -1;
+    if (available < 0) {
+        GLint formats = 0;
+        if (GLEW_VERSION_4_1 || GLEW_ARB_get_program_binary)
+            glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        available = formats > 0;
+    }
+    return available;
+}
+
+std::string program_cache_key(const std::string& v_source, const std::string& f_source) {
+    unsigned long long h = source_hash(v_source);
+    h = source_hash(std::string(1, '\0') + f_source, h);
+    h = source_hash(gl_string(GL_VENDOR) + '\0' + gl_string(GL_RENDERER) + '\0' + gl_string(GL_VERSION), h);
+    char key[17];
+    snprintf(key, sizeof(key), "%016llx", h);
+    return key;
+}
+
+bool program_cache_load(GLuint prog, const std::string& key) {
+    if (!program_cache_available()) return false;
+
+    std::string path = entry_path(key);
+    std::ifstream in(path.c_str(), std::ios::in | std::ios::binary);
+    if (!in) return false;
+
+    cache_header header;
+    std::vector<char> binary;
+    in.read((char*)&header, sizeof(header));
+    bool valid = in && std::memcmp(header.magic, magic, 4) == 0 && header.version == format_version
+                 && key.compare(0, 16, header.key, 16) == 0;
+    if (valid) {
+        binary.resize(header.length);
+        in.read(&binary[0], header.length);
+        valid = (bool)in;
+    }
+    in.close();
+
+    if (valid) {
+        glProgramBinary(prog, header.binary_format, &binary[0], binary.size());
+        GLint linked = GL_FALSE;
+        glGetProgramiv(prog, GL_LINK_STATUS, &linked);
+        if (linked) return true;
+    }
+    //truncated, from an older format, or the driver refused it: drop it, it'll be rebuilt from source
+    printf("Discarding stale program cache entry %s\n", path.c_str());
+    std::remove(path.c_str());
+    return false;
+}
+
+void program_cache_prepare(GLuint prog) {
+    if (program_cache_available()) glProgramParameteri(prog, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+}
+
+void program_cache_store(GLuint prog, const std::string& key) {
+    if (!program_cache_available()) return;
+
+    GLint length = 0;
+    glGetProgramiv(prog, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) return;
+
+    std::vector<char> binary(length);
+    cache_header header;
+    std::memset(&header, 0, sizeof(header));
+    glGetProgramBinary(prog, length, &length, &header.binary_format, &binary[0]);
+    std::memcpy(header.magic, magic, 4);
+    header.version = format_version;
+    header.length = length;
+    std::memcpy(header.key, key.c_str(), 16);
+
+    if (!make_dirs(PROGRAM_CACHE_DIR)) return;
+    //write to a temporary first so a crash mid-write never leaves a half entry behind
+    std::string path = entry_path(key), tmp = path + ".tmp";
+    std::ofstream out(tmp.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    out.write((const char*)&header, sizeof(header));
+    out.write(&binary[0], length);
+    out.close();
+    if (!out || std::rename(tmp.c_str(), path.c_str()) != 0) std::remove(tmp.c_str());
+}
@@ -0,0 +1,43 @@
+#include "renderqueue.h"
+#include "profiler.h"
+#include "glstate.h"
+#include <algorithm>
+
+void RenderQueue::clear() {
+    items.clear();
+}
+
+void RenderQueue::add(const char *label, float depth, GLuint program, std::function<void()> draw, std::function<void()> drawDepth) {
+    items.push_back(RenderItem{label, depth, program, draw, drawDepth});
+}
+
+void RenderQueue::render(bool depthPrepass, GpuProfiler *profiler) {
+    std::stable_sort(items.begin(), items.end(), [](const RenderItem &a, const RenderItem &b) {
+        if (a.depth != b.depth) return a.depth < b.depth;
+        return a.program < b.program;
+    });
+
+    if (depthPrepass) {
+        PROFILE_ZONE("depth prepass");
+        glState.colorMask(false);
+        {
+            GpuZone zone(profiler, "depth prepass");
+            for (const RenderItem &item : items) {
+                if (item.drawDepth) item.drawDepth();
+            }
+        }
+        glState.colorMask(true);
+        //equal depth has to pass now; items without a depth version still write their own
+        glState.depthFunc(GL_LEQUAL);
+    }
+    for (const RenderItem &item : items) {
+        PROFILE_ZONE(item.label);
+        GpuZone zone(profiler, item.label);
+        item.draw();
+    }
+    if (depthPrepass) glState.depthFunc(GL_LESS);
+}
+
+float viewDepth(const glm::mat4 &view, const glm::vec3 &point) {
+    return -(view * glm::vec4(point, 1.f)).z;
+}
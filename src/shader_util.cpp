@@ -3,16 +3,28 @@
  * Shader configuration utility routines.
  */
 #include "shader_util.h"
+#include "consts.h"
+#include "programcache.h"
+#include "shaderregistry.h"
+#include "renderstats.h"
+#include "glstate.h"
+#include "profiler.h"
 #include <stdexcept>
 #include <cerrno>
 #include <iostream>
 #include <sstream>
 #include <fstream>
 #include <vector>
+#include <algorithm>
+#include <thread>
 #include <cstring>
 #include <stdlib.h>
 using std::strcpy;
 
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1 // GL_KHR_parallel_shader_compile, newer than our GLEW
+#endif
+
 // -------- Utility functions --------------
 /**
  * Reads file contents into a string.
@@ -25,11 +37,9 @@ std::string get_file_contents(const char *filename) {
 }
 
 /**
- * Allocates and compiles given shader in OpenGL
+ * Hands the source to the driver and starts compiling it, without waiting for the result
  */
-GLuint compile(GLuint type, std::string source) {
-    GLuint shader = glCreateShader(type);
-
+void compile_source(GLuint shader, const std::string& source) {
     // Split the code into separate lines (then the compilation error messages are more informative)
     std::vector<GLchar *> lines;
     std::string line;
@@ -45,7 +55,12 @@ GLuint compile(GLuint type, std::string source) {
     glShaderSource(shader, lines.size(), (const GLchar**)&lines[0], NULL);
     glCompileShader(shader);
     for (unsigned int i = 0; i < lines.size(); i++) free(lines[i]);
+}
 
+/**
+ * Throws with the info log if the shader failed to compile (blocks until the driver is done with it)
+ */
+void check_compile(GLuint shader) {
     GLint compiled;
     glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
     if (!compiled) {
@@ -55,11 +70,54 @@ GLuint compile(GLuint type, std::string source) {
         glGetShaderInfoLog(shader, length, &length, &log[0]);
         std::cout << "Shader compilation error: " << log << std::endl;
         throw std::logic_error(log);
-        return false;
     }
+}
+
+/**
+ * Allocates and compiles given shader in OpenGL
+ */
+GLuint compile(GLuint type, std::string source) {
+    GLuint shader = glCreateShader(type);
+    compile_source(shader, source);
+    check_compile(shader);
     return shader;
 }
 
+/**
+ * Pastes the shared FrameGlobals block (see shaders/frameglobals.glsl) and any extra lines (#defines
+ * selecting a shader variant) after the leading #version/#extension lines, followed by a #line directive
+ * so compile errors keep the original line numbers
+ */
+std::string add_preamble(const std::string& source, const char* defines) {
+    static const std::string preamble = get_file_contents(FRAME_GLOBALS_GLSL);
+
+    std::istringstream ss(source);
+    std::string line;
+    size_t insert_at = std::string::npos, pos = 0;
+    int lineno = 0, insert_line = 0;
+    while (getline(ss, line)) {
+        pos += line.size() + 1;
+        lineno++;
+        size_t first = line.find_first_not_of(" \t\r");
+        if (first == std::string::npos) continue;
+        if (line.compare(first, 8, "#version") == 0 || line.compare(first, 10, "#extension") == 0) {
+            insert_at = std::min(pos, source.size());
+            insert_line = lineno;
+        } else if (insert_at != std::string::npos) {
+            break;
+        }
+    }
+    if (insert_at == std::string::npos) return source; //no #version, leave it alone
+
+    std::ostringstream out;
+    out << source.substr(0, insert_at);
+    if (insert_at == source.size() && source[insert_at - 1] != '\n') out << '\n';
+    out << preamble << '\n';
+    if (defines) out << defines << '\n';
+    out << "#line " << insert_line + 1 << "\n" << source.substr(insert_at);
+    return out.str();
+}
+
 const GLchar *default_vertex_shader =
     "#version 120\n"
     "varying vec4 vertex_color\n;"
@@ -75,71 +133,269 @@ const GLchar *default_fragment_shader =
     "    gl_FragColor = vertex_color;\n"
     "}";
 
-shader_prog::shader_prog(const char* vertex_shader_filename, const char* fragment_shader_filename) {
-    v_source = vertex_shader_filename == NULL ? std::string((const char*)default_vertex_shader) : get_file_contents(vertex_shader_filename);
-    f_source = fragment_shader_filename == NULL ? std::string((const char*)default_fragment_shader) : get_file_contents(fragment_shader_filename);
+bool shader_prog::parallel_compile = false;
+std::function<void(std::function<void()>)> shader_prog::background;
+
+shader_prog::shader_prog(const char* vertex_shader_filename, const char* fragment_shader_filename, const char* defines) {
+    v_source = vertex_shader_filename == NULL ? std::string((const char*)default_vertex_shader) : add_preamble(get_file_contents(vertex_shader_filename), defines);
+    f_source = fragment_shader_filename == NULL ? std::string((const char*)default_fragment_shader) : add_preamble(get_file_contents(fragment_shader_filename), defines);
+}
+
+
+/**
+ * Throws with the info log if the program failed to link
+ */
+void check_link(GLuint prog) {
+    GLint linked;
+    glGetProgramiv(prog, GL_LINK_STATUS, &linked);
+    if (!linked) {
+        GLint length;
+        glGetProgramiv(prog, GL_INFO_LOG_LENGTH, &length);
+        std::string log(length, ' ');
+        glGetProgramInfoLog(prog, length, &length, &log[0]);
+        std::cout << "Program link error: " << log << std::endl;
+        throw std::logic_error(log);
+    }
+}
+
+/**
+ * Runs a GL job the way shader_prog::background says: on the loader thread if there is one,
+ * right away otherwise. Jobs run in submission order, so a link always comes after its compiles
+ */
+void run_gl_job(std::function<void()> job) {
+    if (shader_prog::background) shader_prog::background(job);
+    else job();
 }
 
+/**
+ * Shared stage for this source, compiling it if nobody has asked for it before
+ */
+std::shared_ptr<shader_stage> submit_stage(GLenum type, const std::string& source) {
+    bool created;
+    std::shared_ptr<shader_stage> stage = registry_stage(type, source, created);
+    if (created) {
+        GLuint shader = stage->shader;
+        run_gl_job([shader, source]() {
+            PROFILE_ZONE("compile shader");
+            compile_source(shader, source);
+        });
+    }
+    return stage;
+}
 
-//first thing that gets called after constructor
+//first thing that gets called after constructor: compiles and links, blocking until done
 void shader_prog::setup() {
-    //compile
-    vertex_shader = compile(GL_VERTEX_SHADER, v_source);
-    fragment_shader = compile(GL_FRAGMENT_SHADER, f_source);
-    //identifying GLUint for program
-    prog = glCreateProgram();
-    //attach
-    glAttachShader(prog, vertex_shader);
-    glAttachShader(prog, fragment_shader);
-    //link
-    glLinkProgram(prog);
-    glDeleteShader(vertex_shader);
-    glDeleteShader(fragment_shader);
+    PROFILE_ZONE("shader_prog::setup");
+    submit();
+    if (state->status == program_state::compiling) {
+        while (state->background_done && !*state->background_done) std::this_thread::yield();
+        finish();
+    }
+}
+
+/**
+ * Starts building the program without waiting on the driver: submit every program first and
+ * poll() them later, so the compiles overlap (GL_KHR_parallel_shader_compile or the loader thread).
+ * Programs with the same sources share one GL program through the shader registry
+ */
+void shader_prog::submit() {
+    PROFILE_ZONE("shader_prog::submit");
+    bool created;
+    state = registry_program(v_source, f_source, created);
+    if (created) {
+        //identifying GLUint for program
+        state->prog = glCreateProgram();
+
+        //a binary cached by an earlier run skips compiling and linking entirely
+        std::string cache_key = program_cache_key(v_source, f_source);
+        if (program_cache_load(state->prog, cache_key)) {
+            finish();
+        } else {
+            state->cache_key = cache_key;
+            //compile (each unique stage only once)
+            state->vertex = submit_stage(GL_VERTEX_SHADER, v_source);
+            state->fragment = submit_stage(GL_FRAGMENT_SHADER, f_source);
+            program_cache_prepare(state->prog);
+            state->status = program_state::compiling;
+
+            GLuint vs = state->vertex->shader, fs = state->fragment->shader, p = state->prog;
+            std::shared_ptr<std::atomic<bool>> done;
+            if (background) done = std::make_shared<std::atomic<bool>>(false);
+            state->background_done = done;
+            run_gl_job([vs, fs, p, done]() {
+                PROFILE_ZONE("link program");
+                //attach
+                glAttachShader(p, vs);
+                glAttachShader(p, fs);
+                //link
+                glLinkProgram(p);
+                if (done) {
+                    //on the loader thread's shared context: make sure the driver is done before flagging it
+                    glFinish();
+                    *done = true;
+                }
+            });
+        }
+    }
+
+    //the compile jobs hold their own copies, nothing needs the text anymore
+    std::string().swap(v_source);
+    std::string().swap(f_source);
+}
+
+/**
+ * Non-blocking check whether the program is ready to use, finishing it up the first time it is.
+ * Compile/link errors are thrown from here
+ */
+bool shader_prog::poll() {
+    if (!state) return false;
+    if (state->status != program_state::compiling) return state->status == program_state::ready;
+    if (state->background_done) {
+        if (!*state->background_done) return false;
+    } else if (parallel_compile) {
+        GLint completed = GL_FALSE;
+        glGetProgramiv(state->prog, GL_COMPLETION_STATUS_KHR, &completed);
+        if (!completed) return false;
+    }
+    finish();
+    return true;
+}
+
+bool shader_prog::is_ready() const {
+    return state && state->status == program_state::ready;
+}
+
+void shader_prog::finish() {
+    PROFILE_ZONE("shader_prog::finish");
+    state->background_done.reset();
+    if (state->vertex) {
+        state->status = program_state::failed;
+        for (shader_stage* stage : {state->vertex.get(), state->fragment.get()}) {
+            if (!stage->checked) check_compile(stage->shader);
+            stage->checked = true;
+        }
+        //the program keeps working without them, and the registry keeps the stages for reuse
+        glDetachShader(state->prog, state->vertex->shader);
+        glDetachShader(state->prog, state->fragment->shader);
+        state->vertex.reset();
+        state->fragment.reset();
+        check_link(state->prog);
+        program_cache_store(state->prog, state->cache_key);
+        state->cache_key.clear();
+    }
+    //point the shared per-frame block (if the program uses it) at the UBO bound by FrameUniforms
+    GLuint block = glGetUniformBlockIndex(state->prog, "FrameGlobals");
+    if (block != GL_INVALID_INDEX) glUniformBlockBinding(state->prog, block, FRAME_GLOBALS_BINDING);
+    reflect();
+    state->status = program_state::ready;
+}
+
+/**
+ * Queries every active uniform once after linking, so nothing has to call glGetUniformLocation later on
+ */
+void shader_prog::reflect() {
+    GLuint prog = state->prog;
+    std::vector<uniform_info>& uniforms = state->uniforms;
+    uniforms.clear();
+    GLint count = 0, maxlength = 0;
+    glGetProgramiv(prog, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(prog, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxlength);
+    uniforms.reserve(count);
+
+    std::vector<GLchar> namebuf(maxlength + 1);
+    for (GLint i = 0; i < count; i++) {
+        uniform_info u;
+        GLsizei length = 0;
+        glGetActiveUniform(prog, i, namebuf.size(), &length, &u.size, &u.type, &namebuf[0]);
+        u.name.assign(&namebuf[0], length);
+        //arrays are reported as "name[0]", we want to find them by their plain name
+        if (u.name.size() > 3 && u.name.compare(u.name.size() - 3, 3, "[0]") == 0)
+            u.name.resize(u.name.size() - 3);
+
+        GLuint index = i;
+        glGetActiveUniformsiv(prog, 1, &index, GL_UNIFORM_BLOCK_INDEX, &u.block);
+        u.location = u.block < 0 ? glGetUniformLocation(prog, u.name.c_str()) : -1;
+        uniforms.push_back(u);
+    }
+    std::sort(uniforms.begin(), uniforms.end(),
+              [](const uniform_info& a, const uniform_info& b) { return a.name < b.name; });
 }
 
 void shader_prog::begin() {
-    glUseProgram(prog);
+    glState.useProgram(state->prog);
 }
 
+//leaves the program bound: the next begin() only switches if it's a different one (see GLState)
 void shader_prog::end() {
-    glUseProgram(0);
 }
 
+//the GL program goes away with the last shader_prog sharing it
 void shader_prog::free() {
-    glDeleteProgram(prog);
-    glDeleteShader(vertex_shader);
-    glDeleteShader(fragment_shader);
-    glUseProgram(0);
+    if (state && state.use_count() == 1) glDeleteProgram(state->prog);
+    state.reset();
+    glState.useProgram(0);
 }
 
 shader_prog::operator GLuint() {
-    return prog;
+    return state ? state->prog : 0;
+}
+
+const std::vector<uniform_info>& shader_prog::active_uniforms() const {
+    static const std::vector<uniform_info> none;
+    return state ? state->uniforms : none;
+}
+
+const uniform_info* shader_prog::find_uniform(const char* name) const {
+    const std::vector<uniform_info>& uniforms = active_uniforms();
+    auto it = std::lower_bound(uniforms.begin(), uniforms.end(), name,
+                               [](const uniform_info& u, const char* n) { return u.name.compare(n) < 0; });
+    if (it == uniforms.end() || it->name != name) return NULL;
+    return &*it;
+}
+
+uniform_handle shader_prog::try_handle(const char* name) const {
+    uniform_handle h;
+    const uniform_info* u = find_uniform(name);
+    if (u) h.loc = u->location;
+    return h;
+}
+
+uniform_handle shader_prog::handle(const char* name) const {
+    uniform_handle h = try_handle(name);
+    if (h.loc < 0) throw (std::runtime_error(std::string("Location not found in shader program for variable ") + name));
+    return h;
 }
 
 void shader_prog::uniform1i(const char* name, int i) {
-    GLint loc = glGetUniformLocation(prog, name);
-    if (loc < 0) throw (std::runtime_error(std::string("Location not found in shader program for variable ") + name));
-    glUniform1i(loc, i);
+    glUniform1i(handle(name).loc, i);
 }
 void shader_prog::uniform1f(const char* name, float f) {
-    GLint loc = glGetUniformLocation(prog, name);
-    if (loc < 0) throw (std::runtime_error(std::string("Location not found in shader program for variable ") + name));
-    glUniform1f(loc, f);
+    glUniform1f(handle(name).loc, f);
 }
 void shader_prog::uniform3f(const char* name, float x, float y, float z) {
-    GLint loc = glGetUniformLocation(prog, name);
-    if (loc < 0) throw (std::runtime_error(std::string("Location not found in shader program for variable ") + name));
-    glUniform3f(loc, x, y, z);
+    glUniform3f(handle(name).loc, x, y, z);
 }
 void shader_prog::uniformMatrix4fv(const char* name, const float* matrix) {
-    GLint loc = glGetUniformLocation(prog, name);
-    if (loc < 0) throw (std::runtime_error(std::string("Location not found in shader program for variable ") + name));
-    glUniformMatrix4fv(loc, 1, GL_FALSE, matrix);
+    glUniformMatrix4fv(handle(name).loc, 1, GL_FALSE, matrix);
 }
 void shader_prog::uniformMatrix4fv(const char* name, glm::mat4 matrix) {
-    GLint loc = glGetUniformLocation(prog, name);
-    if (loc < 0) throw (std::runtime_error(std::string("Location not found in shader program for variable ") + name));
-    glUniformMatrix4fv(loc, 1, GL_FALSE, glm::value_ptr(matrix));
+    glUniformMatrix4fv(handle(name).loc, 1, GL_FALSE, glm::value_ptr(matrix));
+}
+
+void shader_prog::uniform1i(uniform_handle h, int i) {
+    glUniform1i(h.loc, i);
+}
+void shader_prog::uniform1f(uniform_handle h, float f) {
+    glUniform1f(h.loc, f);
+}
+void shader_prog::uniform3f(uniform_handle h, float x, float y, float z) {
+    glUniform3f(h.loc, x, y, z);
+}
+void shader_prog::uniform4f(uniform_handle h, float x, float y, float z, float w) {
+    glUniform4f(h.loc, x, y, z, w);
+}
+void shader_prog::uniformMatrix4fv(uniform_handle h, const glm::mat4& matrix) {
+    glUniformMatrix4fv(h.loc, 1, GL_FALSE, glm::value_ptr(matrix));
 }
 void shader_prog::attribute3fv(const char* name, GLfloat* vecArray, int numberOfVertices) {
     GLuint vboHandle;
@@ -147,7 +403,7 @@ void shader_prog::attribute3fv(const char* name, GLfloat* vecArray, int numberOf
     glBindBuffer(GL_ARRAY_BUFFER, vboHandle);
     glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat)*numberOfVertices, vecArray, GL_STATIC_DRAW);
 
-    GLuint loc = glGetAttribLocation(prog, name);
+    GLint loc = glGetAttribLocation(*this, name);
     if (loc < 0) throw (std::runtime_error(std::string("Location not found in shader program for variable ") + name));
     glEnableVertexAttribArray(loc);
 
@@ -0,0 +1,100 @@
+#include "shaderloader.h"
+#include "shader_util.h"
+#include "profiler.h"
+#include "headless.h"
+#include <cstring>
+#include <cstdio>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+
+namespace {
+    typedef void (GLAPIENTRY *MaxShaderCompilerThreadsFn)(GLuint count);
+
+    GLFWwindow *loaderWindow = NULL;
+    std::thread loaderThread;
+    std::mutex queueMutex;
+    std::condition_variable queueCond;
+    std::deque<std::function<void()>> jobs;
+    bool stopping = false;
+
+    bool hasExtension(const char *name) {
+        GLint count = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+        for (GLint i = 0; i < count; i++) {
+            const char *ext = (const char *)glGetStringi(GL_EXTENSIONS, i);
+            if (ext && strcmp(ext, name) == 0) return true;
+        }
+        return false;
+    }
+
+    void loaderLoop() {
+        glfwMakeContextCurrent(loaderWindow);
+        profileThreadName("shader loader");
+        for (;;) {
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> lock(queueMutex);
+                queueCond.wait(lock, [] { return stopping || !jobs.empty(); });
+                if (jobs.empty()) break;
+                job = std::move(jobs.front());
+                jobs.pop_front();
+            }
+            job();
+        }
+        glfwMakeContextCurrent(NULL);
+    }
+}
+
+void startShaderLoader(GLFWwindow *win) {
+    bool khr = hasExtension("GL_KHR_parallel_shader_compile");
+    if (khr || hasExtension("GL_ARB_parallel_shader_compile")) {
+        //let the driver use as many compiler threads as it likes
+        const char *name = khr ? "glMaxShaderCompilerThreadsKHR" : "glMaxShaderCompilerThreadsARB";
+        MaxShaderCompilerThreadsFn maxThreads = win ? (MaxShaderCompilerThreadsFn)glfwGetProcAddress(name)
+                                                    : (MaxShaderCompilerThreadsFn)HeadlessContext::procAddress(name);
+        if (maxThreads) maxThreads(0xFFFFFFFF);
+        shader_prog::parallel_compile = true;
+        printf("Shader compilation: driver parallel compile\n");
+        return;
+    }
+    if (!win) return;
+
+    glfwWindowHint(GLFW_VISIBLE, GL_FALSE);
+    loaderWindow = glfwCreateWindow(1, 1, "shader loader", NULL, win);
+    glfwDefaultWindowHints();
+    if (!loaderWindow) {
+        printf("Shader compilation: synchronous (could not create a shared context)\n");
+        return;
+    }
+
+    stopping = false;
+    loaderThread = std::thread(loaderLoop);
+    shader_prog::background = [](std::function<void()> job) {
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            jobs.push_back(std::move(job));
+        }
+        queueCond.notify_one();
+    };
+    printf("Shader compilation: loader thread\n");
+}
+
+void stopShaderLoader() {
+    shader_prog::background = nullptr;
+    shader_prog::parallel_compile = false;
+    if (loaderThread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            stopping = true;
+        }
+        queueCond.notify_one();
+        loaderThread.join();
+    }
+    if (loaderWindow) {
+        glfwDestroyWindow(loaderWindow);
+        loaderWindow = NULL;
+    }
+}
@@ -0,0 +1,44 @@
+#include "shaderregistry.h"
+#include "programcache.h"
+#include <map>
+#include <cstdio>
+
+namespace {
+    //stages stay alive for the whole run: they are few, and keeping them means a program created later
+    //with an already seen stage never compiles it again
+    std::map<std::string, std::shared_ptr<shader_stage>> stages;
+    //programs only live as long as some shader_prog uses them
+    std::map<std::pair<unsigned long long, unsigned long long>, std::weak_ptr<program_state>> programs;
+}
+
+std::shared_ptr<shader_stage> registry_stage(GLenum type, const std::string& source, bool& created) {
+    char key[32];
+    snprintf(key, sizeof(key), "%x:%016llx", type, source_hash(source));
+
+    std::shared_ptr<shader_stage>& stage = stages[key];
+    created = !stage;
+    if (created) {
+        stage = std::make_shared<shader_stage>();
+        stage->shader = glCreateShader(type);
+        stage->type = type;
+        stage->checked = false;
+    }
+    return stage;
+}
+
+std::shared_ptr<program_state> registry_program(const std::string& v_source, const std::string& f_source, bool& created) {
+    std::weak_ptr<program_state>& entry = programs[std::make_pair(source_hash(v_source), source_hash(f_source))];
+    std::shared_ptr<program_state> state = entry.lock();
+    created = !state;
+    if (created) {
+        state = std::make_shared<program_state>();
+        entry = state;
+    }
+    return state;
+}
+
+void registry_stats(size_t& stagecount, size_t& programcount) {
+    stagecount = stages.size();
+    programcount = 0;
+    for (const auto& p : programs) programcount += !p.second.expired();
+}
@@ -0,0 +1,272 @@
+#include "shards.h"
+#include "exporter.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#ifndef _WIN32
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#endif
+
+#ifdef _WIN32
+
+bool runShards(int, char *[], const Options &) {
+    printf("--shards starts its workers with fork, which isn't available on this platform\n");
+    return false;
+}
+
+#else
+
+namespace {
+    struct Shard {
+        long start, end;
+        bool done;
+        pid_t pid;      //0 while not running
+    };
+
+    //png, ppm, y4m or raw, the way Exporter decides it
+    std::string exportFormat(const Options &opts) {
+        if (opts.exportFormat) return opts.exportFormat;
+        std::string name(opts.exportPath);
+        size_t dot = name.rfind('.');
+        return dot == std::string::npos ? "" : name.substr(dot + 1);
+    }
+
+    //the export path without its frame number or extension, the coordinator's files are named after it
+    std::string stateBase(const char *exportPath) {
+        std::string name(exportPath);
+        size_t percent = name.find('%');
+        if (percent != std::string::npos) name.erase(percent, name.find('d', percent) + 1 - percent);
+        size_t slash = name.rfind('/');
+        size_t dot = name.rfind('.');
+        if (dot != std::string::npos && (slash == std::string::npos || dot > slash)) name.erase(dot);
+        while (!name.empty() && (name.back() == '_' || name.back() == '-')) name.pop_back();
+        if (name.empty() || name.back() == '/') name += "export";
+        return name;
+    }
+
+    bool exists(const std::string &path) {
+        return access(path.c_str(), F_OK) == 0;
+    }
+
+    //whether everything s renders is on disk: its part file at full length, or each of its numbered images.
+    //A worker's exit status alone doesn't say, it may have been killed halfway through a close
+    bool rendered(const Shard &s, const Options &opts, const std::string &format, const std::string &base) {
+        if (format == "y4m" || format == "raw") {
+            struct stat st;
+            if (stat((base + ".part" + std::to_string(s.start)).c_str(), &st) != 0) return false;
+            //RGB or 4:4:4, plus the FRAME line of y4m and (not counted) its stream header
+            long long frameBytes = (long long)opts.width * opts.height * 3 + (format == "y4m" ? 6 : 0);
+            return (long long)st.st_size >= (s.end - s.start) * frameBytes;
+        }
+        std::string pattern = Exporter::framePattern(opts.exportPath);
+        char name[1024];
+        for (long f = s.start; f < s.end; f++) {
+            snprintf(name, sizeof(name), pattern.c_str(), (int)f);
+            if (!exists(name)) return false;
+        }
+        return true;
+    }
+
+    //appends src to out, leaving out its first line if skipHeader (the y4m stream header)
+    bool append(FILE *out, const std::string &src, bool skipHeader) {
+        FILE *in = fopen(src.c_str(), "rb");
+        if (!in) return false;
+        if (skipHeader) {
+            int c;
+            while ((c = fgetc(in)) != EOF && c != '\n') {}
+        }
+        std::vector<char> buffer(1 << 20);
+        size_t n;
+        bool ok = true;
+        while (ok && (n = fread(buffer.data(), 1, buffer.size(), in)) > 0) {
+            ok = fwrite(buffer.data(), 1, n, out) == n;
+        }
+        if (ferror(in)) ok = false;
+        fclose(in);
+        return ok;
+    }
+
+    //forks a worker for s with its output going to log, the pid or -1
+    pid_t launch(const std::vector<std::string> &args, const Shard &s, const std::string &target,
+                 const std::string &format, const std::string &log, int threads) {
+        std::vector<std::string> full(args);
+        char range[64];
+        snprintf(range, sizeof(range), "%ld:%ld", s.start, s.end);
+        full.insert(full.end(), {"--export", target, "--export-format", format, "--frame-range", range});
+        std::vector<char*> argv;
+        for (std::string &a : full) argv.push_back(&a[0]);
+        argv.push_back(NULL);
+
+        fflush(stdout);
+        pid_t pid = fork();
+        if (pid != 0) return pid;
+        int fd = open(log.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd >= 0) {
+            dup2(fd, 1);
+            dup2(fd, 2);
+            close(fd);
+        }
+        char value[16];
+        snprintf(value, sizeof(value), "%d", threads);
+        setenv("LP_NUM_THREADS", value, 1);
+        execvp(argv[0], argv.data());
+        fprintf(stderr, "Shards: can't run %s\n", argv[0]);
+        _exit(127);
+    }
+}
+
+bool runShards(int argc, char *argv[], const Options &opts) {
+    std::string format = exportFormat(opts);
+    bool stream = format == "y4m" || format == "raw";
+    if (!stream && format != "png" && format != "ppm") {
+        printf("Shards: unknown format for %s, use --export-format png|ppm|y4m|raw\n", opts.exportPath);
+        return false;
+    }
+    int processes = opts.shards;
+    int cores = std::max(1, (int)std::thread::hardware_concurrency());
+    int threads = opts.shardThreads > 0 ? opts.shardThreads : std::max(1, cores / processes);
+
+    //what every worker runs, everything the coordinator decides itself left out
+    std::vector<std::string> args{argv[0]};
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        if (strcmp(arg, "--shards") == 0 || strcmp(arg, "--shard-frames") == 0 || strcmp(arg, "--shard-threads") == 0
+            || strcmp(arg, "--export") == 0 || strcmp(arg, "--export-format") == 0
+            || strcmp(arg, "--frame-range") == 0 || strcmp(arg, "--frames") == 0) {
+            i++;
+            continue;
+        }
+        args.push_back(arg);
+    }
+    args.push_back("--frames");
+    args.push_back(std::to_string(opts.frames));
+
+    //a manifest written for the same command is picked up where it stopped
+    std::string base = stateBase(opts.exportPath);
+    std::string manifestPath = base + ".shards";
+    std::string key = "export " + std::string(opts.exportPath) + " " + format;
+    for (const std::string &a : args) key += " " + a;
+    long shardFrames = opts.shardFrames > 0 ? opts.shardFrames
+                       : std::max(1L, (opts.frames + processes * SHARDS_PER_WORKER - 1) / (processes * SHARDS_PER_WORKER));
+    std::vector<std::pair<long, long>> finished;
+    if (FILE *in = fopen(manifestPath.c_str(), "r")) {
+        std::vector<char> line(key.size() + 2);
+        long size;
+        if (fgets(line.data(), line.size(), in) && std::string(line.data()) == key + "\n" && fscanf(in, "shard-frames %ld\n", &size) == 1) {
+            shardFrames = size;
+            long start, end;
+            while (fscanf(in, "done %ld %ld\n", &start, &end) == 2) finished.push_back({start, end});
+        } else {
+            printf("Shards: %s is from another render, starting over\n", manifestPath.c_str());
+        }
+        fclose(in);
+    }
+
+    std::vector<Shard> shards;
+    long pending = 0;
+    for (long start = 0; start < opts.frames; start += shardFrames) {
+        Shard s{start, std::min(start + shardFrames, opts.frames), false, 0};
+        s.done = std::find(finished.begin(), finished.end(), std::make_pair(s.start, s.end)) != finished.end();
+        //output that has gone missing since is rendered again
+        if (s.done && !rendered(s, opts, format, base)) s.done = false;
+        if (!s.done) pending += s.end - s.start;
+        shards.push_back(s);
+    }
+
+    FILE *manifest = fopen(manifestPath.c_str(), "w");
+    if (!manifest) {
+        printf("Shards: can't write %s\n", manifestPath.c_str());
+        return false;
+    }
+    fprintf(manifest, "%s\nshard-frames %ld\n", key.c_str(), shardFrames);
+    for (const Shard &s : shards) {
+        if (s.done) fprintf(manifest, "done %ld %ld\n", s.start, s.end);
+    }
+    fflush(manifest);
+
+    printf("Shards: %ld frames in %zu shards of %ld, %ld left, %d workers x %d threads\n",
+           opts.frames, shards.size(), shardFrames, pending, processes, threads);
+    auto started = std::chrono::steady_clock::now();
+
+    size_t next = 0;
+    int running = 0, failed = 0;
+    for (;;) {
+        while (running < processes && next < shards.size()) {
+            Shard &s = shards[next++];
+            if (s.done) continue;
+            std::string target = stream ? base + ".part" + std::to_string(s.start) : opts.exportPath;
+            s.pid = launch(args, s, target, format, base + ".shard" + std::to_string(s.start) + ".log", threads);
+            if (s.pid < 0) {
+                printf("Shards: can't start a worker for frames %ld-%ld\n", s.start, s.end - 1);
+                s.pid = 0;
+                failed++;
+                continue;
+            }
+            running++;
+        }
+        if (running == 0) break;
+
+        int status;
+        pid_t pid = wait(&status);
+        if (pid < 0) break;
+        for (Shard &s : shards) {
+            if (s.pid != pid) continue;
+            s.pid = 0;
+            running--;
+            std::string log = base + ".shard" + std::to_string(s.start) + ".log";
+            if (WIFEXITED(status) && WEXITSTATUS(status) == 0 && !rendered(s, opts, format, base)) {
+                failed++;
+                printf("Shards: frames %ld-%ld exited fine but their output is missing, see %s\n", s.start, s.end - 1, log.c_str());
+            } else if (WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+                s.done = true;
+                fprintf(manifest, "done %ld %ld\n", s.start, s.end);
+                fflush(manifest);
+                remove(log.c_str());
+                printf("Shards: frames %ld-%ld done\n", s.start, s.end - 1);
+            } else {
+                failed++;
+                if (WIFSIGNALED(status)) printf("Shards: frames %ld-%ld died on signal %d, see %s\n", s.start, s.end - 1, WTERMSIG(status), log.c_str());
+                else printf("Shards: frames %ld-%ld failed with %d, see %s\n", s.start, s.end - 1, WEXITSTATUS(status), log.c_str());
+            }
+        }
+    }
+    fclose(manifest);
+
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    printf("Shards: %ld frames in %.2fs (%.1f fps) with %d workers x %d threads\n",
+           pending, elapsed, elapsed > 0 ? pending / elapsed : 0.0, processes, threads);
+    if (failed > 0) {
+        printf("Shards: %d shards failed, run the same command again to render just those\n", failed);
+        return false;
+    }
+
+    if (stream) {
+        //joined into a temporary and renamed, the parts stay until the whole is there
+        std::string tmp = std::string(opts.exportPath) + ".tmp";
+        FILE *out = fopen(tmp.c_str(), "wb");
+        bool ok = out != NULL;
+        for (size_t i = 0; ok && i < shards.size(); i++) {
+            ok = append(out, base + ".part" + std::to_string(shards[i].start), format == "y4m" && i > 0);
+        }
+        if (out && fclose(out) != 0) ok = false;
+        if (!ok || rename(tmp.c_str(), opts.exportPath) != 0) {
+            printf("Shards: joining the parts into %s failed\n", opts.exportPath);
+            remove(tmp.c_str());
+            return false;
+        }
+        for (const Shard &s : shards) remove((base + ".part" + std::to_string(s.start)).c_str());
+    }
+    remove(manifestPath.c_str());
+    printf("Shards: export written to %s\n", opts.exportPath);
+    return true;
+}
+
+#endif
@@ -1,22 +1,20 @@
 #include <stack>
 #include "testpaintings.h"
+#include "renderstats.h"
+#include "glstate.h"
 
 RedPainting::RedPainting() :
     // calls the base class constructor: this is the important part: change your shaders here
-    Painting(shader_prog("shaders/basic.vert.glsl", "shaders/redpainting.frag.glsl"))
+    Painting(shader_prog("shaders/basic.vert.glsl", "shaders/redpainting.frag.glsl"), "redpainting")
     {
         /////////////
-        //this setup call MUST be inside the derived class constructor:
+        //this submit call MUST be inside the derived class constructor:
         //it doesn't work if it's in the base class for whatever reason
-        //setup compiles the shaders, creates the program, attaches and links the shaders
-        pshader.setup();
+        //submit starts compiling and linking the shaders in the background, until ready() says
+        //it's done main draws a placeholder instead (uniforms get looked up then too)
+        pshader.submit();
         /////////////
-        //begin just calls glUseUniform, and end calls glUseUniform(0)
-        pshader.begin();
-
-        //this uniform stays constant so it doesn't have to be changed after initial setup
-        pshader.uniformMatrix4fv("projectionMatrix", projectionMatrix);
-        pshader.end();
+        //projection, view and time don't need uploading: they come from the shared FrameGlobals block
     };
 
 
@@ -29,33 +27,28 @@ void RedPainting::render(GLuint VAO) {
     //in this case im passing in a VAO to render because I don't want each painting to have its own VAO,
     //but in principle you can store the objects VAO inside it as well, and it'll probably be more convenient
     pshader.begin();
-    pshader.uniformMatrix4fv("viewMatrix", viewMatrix);
-    pshader.uniform1f("time", (float)glfwGetTime());
 
     ms.push(ms.top());
         ms.top() = glm::translate(ms.top(), position);
         ms.top() = glm::rotate(ms.top(), glm::radians(angle), glm::vec3(0., 1., 0.));
         //maybe we can even set up the modelMatrix only once in constructor as well if they don't move around
-        pshader.uniformMatrix4fv("modelMatrix", ms.top());
-        glBindVertexArray(VAO);
+        pshader.uniformMatrix4fv(modelLoc, ms.top());
+        glState.enable(GL_CULL_FACE, true);
+        glState.bindVertexArray(VAO);
         glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_BYTE, 0);
+        renderStats.drawCalls++;
     ms.pop();
     pshader.end();
 };
 
 BluePainting::BluePainting() :
-    Painting(shader_prog("shaders/basic.vert.glsl", "shaders/bluepainting.frag.glsl"))
+    Painting(shader_prog("shaders/basic.vert.glsl", "shaders/bluepainting.frag.glsl"), "bluepainting")
     {
-        pshader.setup();
-        pshader.begin();
-        pshader.uniformMatrix4fv("projectionMatrix", projectionMatrix);
-        pshader.uniform1f("time", (float)glfwGetTime());
-        pshader.end();
+        pshader.submit();
     };
 
 void BluePainting::updateUniforms() {
-    pshader.uniformMatrix4fv("viewMatrix", viewMatrix);
-    pshader.uniform1f("time", (float)glfwGetTime());
+    //nothing per-painting to update: time and the view come from the FrameGlobals block
 }
 
 
@@ -70,9 +63,11 @@ void BluePainting::render(GLuint VAO) {
     ms.push(ms.top());
         ms.top() = glm::translate(ms.top(), position);
         ms.top() = glm::rotate(ms.top(), glm::radians(angle), glm::vec3(0., 1., 0.));
-        pshader.uniformMatrix4fv("modelMatrix", ms.top());
-        glBindVertexArray(VAO);
+        pshader.uniformMatrix4fv(modelLoc, ms.top());
+        glState.enable(GL_CULL_FACE, true);
+        glState.bindVertexArray(VAO);
         glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_BYTE, 0);
+        renderStats.drawCalls++;
     ms.pop();
     pshader.end();
 };
@@ -0,0 +1,56 @@
+#include "threadpool.h"
+#include "profiler.h"
+
+ThreadPool::ThreadPool(int n) :
+    count(0),
+    next(0),
+    working(0),
+    generation(0),
+    stopping(false) {
+    if (n <= 0) n = std::max(1, (int)std::thread::hardware_concurrency());
+    for (int i = 1; i < n; i++) threads.push_back(std::thread(&ThreadPool::threadLoop, this));
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        stopping = true;
+    }
+    poolCond.notify_all();
+    for (std::thread &t : threads) t.join();
+}
+
+void ThreadPool::work() {
+    for (int i = next++; i < count; i = next++) job(i);
+}
+
+void ThreadPool::threadLoop() {
+    profileThreadName("pool");
+    long seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(poolMutex);
+            poolCond.wait(lock, [&] { return stopping || generation != seen; });
+            if (stopping) break;
+            seen = generation;
+        }
+        work();
+        std::lock_guard<std::mutex> lock(poolMutex);
+        if (--working == 0) poolCond.notify_all();
+    }
+}
+
+void ThreadPool::run(int n, const std::function<void(int)> &f) {
+    {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        job = f;
+        count = n;
+        next = 0;
+        working = (int)threads.size();
+        generation++;
+    }
+    poolCond.notify_all();
+    work();
+    std::unique_lock<std::mutex> lock(poolMutex);
+    poolCond.wait(lock, [this] { return working == 0; });
+}
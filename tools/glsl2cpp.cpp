@@ -0,0 +1,1314 @@
+//translates the painting shaders to C++ for the CPU renderer (see cpushaders.h):
+//glsl2cpp -o out.cpp shaders/NAME.frag.glsl...
+//Every painting becomes a CpuShader that registers itself as NAME. It reads the GLSL the paintings are
+//written in: float, int and bool, vec2-4 and mat2, const globals and #define constants, functions with
+//in parameters, if/else, for and while loops, swizzles, the built-in math functions, time and fraguv.
+//Anything past that is reported with its line and the painting is left out (--cpu then says it has no
+//CPU version), it never gets a translation that draws something else.
+//
+//The output shades SIMD_WIDTH pixels at a time (floatv, simd.h), structure of arrays: a vec3 is three
+//floatv, one per component. Lanes can disagree about a branch, so an if runs both sides with the lanes
+//that didn't take one masked out of its assignments (select), a loop goes round until no lane wants
+//another pass, and a return inside a branch only retires its lanes.
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cctype>
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <algorithm>
+
+namespace {
+    //why a shader can't be translated, and where
+    struct GlslError : std::runtime_error {
+        int line;
+        GlslError(int line, const std::string &what) : std::runtime_error(what), line(line) {}
+    };
+
+    enum Type { T_VOID, T_BOOL, T_INT, T_FLOAT, T_VEC2, T_VEC3, T_VEC4, T_MAT2 };
+
+    const char *typeNames[] = {"void", "bool", "int", "float", "vec2", "vec3", "vec4", "mat2"};
+
+    int components(Type t) {
+        switch (t) {
+        case T_VOID: return 0;
+        case T_VEC2: return 2;
+        case T_VEC3: return 3;
+        case T_VEC4: case T_MAT2: return 4;
+        default: return 1;
+        }
+    }
+
+    Type vecType(int n) {
+        return n == 1 ? T_FLOAT : (Type)(T_VEC2 + n - 2);
+    }
+
+    bool isVec(Type t) {
+        return t >= T_VEC2 && t <= T_VEC4;
+    }
+
+    bool isScalar(Type t) {
+        return t == T_INT || t == T_FLOAT;
+    }
+
+    //true with t set for the types above, throws for the GLSL types that aren't among them
+    bool typeByName(const std::string &name, int line, Type &t) {
+        for (int i = 0; i < (int)(sizeof(typeNames) / sizeof(typeNames[0])); i++) {
+            if (name == typeNames[i]) {
+                t = (Type)i;
+                return true;
+            }
+        }
+        static const char *unsupported[] = {
+            "uint", "double", "ivec2", "ivec3", "ivec4", "uvec2", "uvec3", "uvec4", "bvec2", "bvec3", "bvec4",
+            "dvec2", "dvec3", "dvec4", "mat3", "mat4", "mat2x2", "mat2x3", "mat2x4", "mat3x2", "mat3x3",
+            "mat3x4", "mat4x2", "mat4x3", "mat4x4", "struct",
+        };
+        for (const char *u : unsupported) {
+            if (name == u) throw GlslError(line, "the type " + name + " isn't supported");
+        }
+        if (name.find("sampler") != std::string::npos || name.compare(0, 5, "image") == 0) {
+            throw GlslError(line, "textures (" + name + ") aren't supported");
+        }
+        return false;
+    }
+
+    std::string typeName(Type t) {
+        return typeNames[t];
+    }
+
+    struct Token {
+        enum Kind { IDENT, NUMBER, PUNCT, END } kind;
+        std::string text;
+        int line;
+    };
+
+    typedef std::map<std::string, std::vector<Token>> Macros;
+
+    void tokenize(const std::string &src, int line, Macros &macros, std::vector<Token> &out);
+
+    //a line starting with #, without the #. Object-like #defines are all the paintings use
+    void preprocess(const std::string &directive, int line, Macros &macros) {
+        size_t i = directive.find_first_not_of(" \t");
+        if (i == std::string::npos) return;
+        size_t end = directive.find_first_of(" \t(", i);
+        std::string word = directive.substr(i, end == std::string::npos ? std::string::npos : end - i);
+        if (word == "version") return;
+        if (word != "define") throw GlslError(line, "#" + word + " isn't supported");
+
+        i = directive.find_first_not_of(" \t", end);
+        if (i == std::string::npos) throw GlslError(line, "#define without a name");
+        end = i;
+        while (end < directive.size() && (isalnum((unsigned char)directive[end]) || directive[end] == '_')) end++;
+        std::string name = directive.substr(i, end - i);
+        if (end < directive.size() && directive[end] == '(') throw GlslError(line, "#define " + name + "() with parameters isn't supported");
+        std::vector<Token> body;
+        tokenize(directive.substr(end), line, macros, body);
+        macros[name] = body;
+    }
+
+    //src into out, with comments and the preprocessor done. Macros are expanded as they're defined
+    void tokenize(const std::string &src, int line, Macros &macros, std::vector<Token> &out) {
+        static const char *pairs[] = {"++", "--", "+=", "-=", "*=", "/=", "%=", "==", "!=", "<=", ">=",
+                                      "&&", "||", "^^", "<<", ">>"};
+        bool lineStart = true;
+        size_t i = 0;
+        while (i < src.size()) {
+            char c = src[i];
+            char next = i + 1 < src.size() ? src[i + 1] : 0;
+            if (c == '\n') {
+                line++;
+                lineStart = true;
+                i++;
+            } else if (isspace((unsigned char)c)) {
+                i++;
+            } else if (c == '/' && next == '/') {
+                i = src.find('\n', i);
+                if (i == std::string::npos) i = src.size();
+            } else if (c == '/' && next == '*') {
+                size_t end = src.find("*/", i + 2);
+                if (end == std::string::npos) throw GlslError(line, "comment without an end");
+                for (size_t j = i; j < end; j++) {
+                    if (src[j] == '\n') line++;
+                }
+                i = end + 2;
+            } else if (c == '#') {
+                if (!lineStart) throw GlslError(line, "# in the middle of a line");
+                size_t end = src.find('\n', i);
+                if (end == std::string::npos) end = src.size();
+                preprocess(src.substr(i + 1, end - i - 1), line, macros);
+                i = end;
+            } else if (isalpha((unsigned char)c) || c == '_') {
+                lineStart = false;
+                size_t start = i;
+                while (i < src.size() && (isalnum((unsigned char)src[i]) || src[i] == '_')) i++;
+                std::string name = src.substr(start, i - start);
+                auto macro = macros.find(name);
+                if (macro == macros.end()) {
+                    out.push_back({Token::IDENT, name, line});
+                } else {
+                    for (Token t : macro->second) {
+                        t.line = line;
+                        out.push_back(t);
+                    }
+                }
+            } else if (isdigit((unsigned char)c) || (c == '.' && isdigit((unsigned char)next))) {
+                lineStart = false;
+                size_t start = i;
+                while (i < src.size() && (isdigit((unsigned char)src[i]) || src[i] == '.')) i++;
+                if (i < src.size() && (src[i] == 'e' || src[i] == 'E')) {
+                    i++;
+                    if (i < src.size() && (src[i] == '+' || src[i] == '-')) i++;
+                    while (i < src.size() && isdigit((unsigned char)src[i])) i++;
+                }
+                if (i < src.size() && (src[i] == 'f' || src[i] == 'F')) i++;
+                if (i < src.size() && (isalnum((unsigned char)src[i]) || src[i] == '_')) {
+                    throw GlslError(line, "the number " + src.substr(start, i + 1 - start) + "... isn't supported, only decimal float and int");
+                }
+                out.push_back({Token::NUMBER, src.substr(start, i - start), line});
+            } else {
+                lineStart = false;
+                std::string op(1, c);
+                for (const char *p : pairs) {
+                    if (c == p[0] && next == p[1]) op = p;
+                }
+                if (op.size() == 1 && !strchr("+-*/%<>=!(){}[],;.?:&|^~", c)) {
+                    throw GlslError(line, std::string("unexpected '") + c + "'");
+                }
+                out.push_back({Token::PUNCT, op, line});
+                i += op.size();
+            }
+        }
+    }
+
+    struct Expr;
+    typedef std::unique_ptr<Expr> ExprPtr;
+    struct Expr {
+        enum Kind { NUMBER, NAME, UNARY, BINARY, ASSIGN, STEP, CALL, FIELD, SELECT } kind;
+        int line;
+        std::string text;           //the number, name, operator, swizzle or function
+        std::vector<ExprPtr> args;  //operands or call arguments
+    };
+
+    struct Stmt;
+    typedef std::unique_ptr<Stmt> StmtPtr;
+    struct Stmt {
+        enum Kind { BLOCK, DECLARE, EXPRESSION, IF, LOOP, RETURN } kind;
+        int line;
+        Type type;                          //DECLARE
+        bool constant;
+        std::vector<std::string> names;     //DECLARE, with their initializers (NULL for none)
+        std::vector<ExprPtr> inits;
+        ExprPtr expr;                       //EXPRESSION, the RETURN value, IF and LOOP condition
+        ExprPtr step;                       //LOOP
+        StmtPtr init, body, otherwise;      //LOOP init and body, IF branches
+        std::vector<StmtPtr> stmts;         //BLOCK
+    };
+
+    struct Param {
+        Type type;
+        std::string name;
+    };
+
+    struct Function {
+        Type result;
+        std::string name;
+        std::vector<Param> params;
+        StmtPtr body;
+        int line;
+    };
+
+    //what's at the top level, in order: a const declaration or a function
+    struct Global {
+        StmtPtr constant;
+        std::unique_ptr<Function> function;
+    };
+
+    struct Shader {
+        std::vector<Global> globals;
+        std::string output;                 //the out vec4
+        bool fraguv = false;
+        std::vector<std::string> inputs;    //in variables other than fraguv, there's nothing behind them on the CPU
+    };
+
+    class Parser {
+    public:
+        Parser(std::vector<Token> &tokens) : t(tokens) {
+            int line = t.empty() ? 1 : t.back().line;
+            t.push_back({Token::END, "end of file", line});
+        }
+
+        void parse(Shader &shader) {
+            while (peek().kind != Token::END) global(shader);
+        }
+
+    private:
+        std::vector<Token> &t;
+        size_t pos = 0;
+
+        const Token &peek(size_t ahead = 0) const {
+            return t[std::min(pos + ahead, t.size() - 1)];
+        }
+
+        int line() const {
+            return peek().line;
+        }
+
+        bool is(const char *text, size_t ahead = 0) const {
+            const Token &k = peek(ahead);
+            return k.kind != Token::NUMBER && k.kind != Token::END && k.text == text;
+        }
+
+        bool accept(const char *text) {
+            if (!is(text)) return false;
+            pos++;
+            return true;
+        }
+
+        void expect(const char *text) {
+            if (!accept(text)) throw GlslError(line(), std::string("expected '") + text + "' before '" + peek().text + "'");
+        }
+
+        std::string identifier() {
+            if (peek().kind != Token::IDENT) throw GlslError(line(), "expected a name before '" + peek().text + "'");
+            return t[pos++].text;
+        }
+
+        Type type() {
+            std::string name = identifier();
+            Type type;
+            if (!typeByName(name, t[pos - 1].line, type)) throw GlslError(t[pos - 1].line, "unknown type " + name);
+            return type;
+        }
+
+        //keywords for things the translator leaves to the GPU
+        void unsupported() {
+            static const char *words[] = {"break", "continue", "discard", "switch", "do", "struct", "precision",
+                                          "layout", "uniform", "buffer", "shared", "flat", "smooth", "noperspective",
+                                          "invariant", "subroutine", "highp", "mediump", "lowp", "inout", "out", "in"};
+            for (const char *w : words) {
+                if (peek().kind == Token::IDENT && peek().text == w) throw GlslError(line(), std::string(w) + " isn't supported here");
+            }
+        }
+
+        void global(Shader &shader) {
+            int at = line();
+            if (accept("in")) {
+                Type t = type();
+                std::string name = identifier();
+                expect(";");
+                if (name == "fraguv" && t == T_VEC2) shader.fraguv = true;
+                else shader.inputs.push_back(name);
+                return;
+            }
+            if (accept("out")) {
+                Type t = type();
+                std::string name = identifier();
+                expect(";");
+                if (t != T_VEC4) throw GlslError(at, "only a vec4 out is supported");
+                if (!shader.output.empty()) throw GlslError(at, "more than one out isn't supported");
+                shader.output = name;
+                return;
+            }
+            if (accept("uniform")) {
+                std::string type = peek().text;
+                throw GlslError(at, "uniform " + type + " isn't supported, the frame globals are all there is on the CPU");
+            }
+            if (is("const")) {
+                shader.globals.push_back(Global());
+                shader.globals.back().constant = statement();
+                return;
+            }
+            unsupported();
+
+            Type result = type();
+            std::string name = identifier();
+            if (!accept("(")) throw GlslError(at, "global variables other than const aren't supported");
+            std::unique_ptr<Function> f(new Function());
+            f->result = result;
+            f->name = name;
+            f->line = at;
+            if (is("void") && is(")", 1)) {
+                pos++;
+            } else if (!is(")")) {
+                do {
+                    accept("const");
+                    if (is("out") || is("inout")) throw GlslError(line(), peek().text + " parameters aren't supported");
+                    accept("in");
+                    Param p;
+                    p.type = type();
+                    p.name = identifier();
+                    if (is("[")) throw GlslError(line(), "arrays aren't supported");
+                    f->params.push_back(p);
+                } while (accept(","));
+            }
+            expect(")");
+            if (is(";")) throw GlslError(at, "function prototypes aren't supported, define " + name + " before it's used");
+            if (!is("{")) throw GlslError(line(), "expected '{' before '" + peek().text + "'");
+            f->body = statement();
+            shader.globals.push_back(Global());
+            shader.globals.back().function = std::move(f);
+        }
+
+        StmtPtr make(Stmt::Kind kind, int line) {
+            StmtPtr s(new Stmt());
+            s->kind = kind;
+            s->line = line;
+            s->type = T_VOID;
+            s->constant = false;
+            return s;
+        }
+
+        //a declaration, given everything before the type, up to and with the ;
+        StmtPtr declaration(bool constant) {
+            StmtPtr s = make(Stmt::DECLARE, line());
+            s->constant = constant;
+            s->type = type();
+            if (s->type == T_VOID) throw GlslError(s->line, "a void variable");
+            do {
+                s->names.push_back(identifier());
+                if (is("[")) throw GlslError(line(), "arrays aren't supported");
+                s->inits.push_back(accept("=") ? expression() : NULL);
+                if (constant && !s->inits.back()) throw GlslError(s->line, "const " + s->names.back() + " without a value");
+            } while (accept(","));
+            expect(";");
+            return s;
+        }
+
+        StmtPtr statement() {
+            int at = line();
+            if (accept("{")) {
+                StmtPtr s = make(Stmt::BLOCK, at);
+                while (!accept("}")) {
+                    if (peek().kind == Token::END) throw GlslError(at, "{ without a }");
+                    s->stmts.push_back(statement());
+                }
+                return s;
+            }
+            if (accept(";")) return make(Stmt::BLOCK, at);
+            if (accept("if")) {
+                StmtPtr s = make(Stmt::IF, at);
+                expect("(");
+                s->expr = expression();
+                expect(")");
+                s->body = statement();
+                if (accept("else")) s->otherwise = statement();
+                return s;
+            }
+            if (accept("for")) {
+                StmtPtr s = make(Stmt::LOOP, at);
+                expect("(");
+                if (!accept(";")) s->init = simple();
+                if (!is(";")) s->expr = expression();
+                expect(";");
+                if (!is(")")) s->step = expression();
+                expect(")");
+                s->body = statement();
+                return s;
+            }
+            if (accept("while")) {
+                StmtPtr s = make(Stmt::LOOP, at);
+                expect("(");
+                s->expr = expression();
+                expect(")");
+                s->body = statement();
+                return s;
+            }
+            if (accept("return")) {
+                StmtPtr s = make(Stmt::RETURN, at);
+                if (!is(";")) s->expr = expression();
+                expect(";");
+                return s;
+            }
+            unsupported();
+            return simple();
+        }
+
+        //a declaration or an expression statement, what can also start a for
+        StmtPtr simple() {
+            if (accept("const")) return declaration(true);
+            if (peek().kind == Token::IDENT && peek(1).kind == Token::IDENT) return declaration(false);
+            StmtPtr s = make(Stmt::EXPRESSION, line());
+            s->expr = expression();
+            expect(";");
+            return s;
+        }
+
+        ExprPtr make(Expr::Kind kind, int line, const std::string &text) {
+            ExprPtr e(new Expr());
+            e->kind = kind;
+            e->line = line;
+            e->text = text;
+            return e;
+        }
+
+        ExprPtr expression() {
+            ExprPtr lhs = conditional();
+            static const char *ops[] = {"=", "+=", "-=", "*=", "/=", "%="};
+            for (const char *op : ops) {
+                if (is(op)) {
+                    ExprPtr e = make(Expr::ASSIGN, line(), op);
+                    pos++;
+                    e->args.push_back(std::move(lhs));
+                    e->args.push_back(expression());
+                    return e;
+                }
+            }
+            return lhs;
+        }
+
+        ExprPtr conditional() {
+            ExprPtr c = binary(0);
+            if (!is("?")) return c;
+            ExprPtr e = make(Expr::SELECT, line(), "?");
+            pos++;
+            e->args.push_back(std::move(c));
+            e->args.push_back(expression());
+            expect(":");
+            e->args.push_back(conditional());
+            return e;
+        }
+
+        ExprPtr binary(int level) {
+            static const std::vector<std::vector<const char*>> levels = {
+                {"||"}, {"^^"}, {"&&"}, {"|"}, {"^"}, {"&"}, {"==", "!="}, {"<", ">", "<=", ">="},
+                {"<<", ">>"}, {"+", "-"}, {"*", "/", "%"},
+            };
+            if (level == (int)levels.size()) return unary();
+            ExprPtr lhs = binary(level + 1);
+            for (;;) {
+                const char *op = NULL;
+                for (const char *o : levels[level]) {
+                    if (is(o)) op = o;
+                }
+                if (!op) return lhs;
+                ExprPtr e = make(Expr::BINARY, line(), op);
+                pos++;
+                e->args.push_back(std::move(lhs));
+                e->args.push_back(binary(level + 1));
+                lhs = std::move(e);
+            }
+        }
+
+        ExprPtr unary() {
+            static const char *ops[] = {"-", "+", "!", "~"};
+            for (const char *op : ops) {
+                if (is(op)) {
+                    ExprPtr e = make(Expr::UNARY, line(), op);
+                    pos++;
+                    e->args.push_back(unary());
+                    return e;
+                }
+            }
+            if (is("++") || is("--")) {
+                ExprPtr e = make(Expr::STEP, line(), peek().text);
+                pos++;
+                e->args.push_back(unary());
+                return e;
+            }
+            return postfix();
+        }
+
+        ExprPtr postfix() {
+            ExprPtr e = primary();
+            for (;;) {
+                if (is(".")) {
+                    pos++;
+                    ExprPtr f = make(Expr::FIELD, line(), identifier());
+                    f->args.push_back(std::move(e));
+                    e = std::move(f);
+                } else if (is("++") || is("--")) {
+                    ExprPtr s = make(Expr::STEP, line(), peek().text);
+                    pos++;
+                    s->args.push_back(std::move(e));
+                    e = std::move(s);
+                } else if (is("[")) {
+                    throw GlslError(line(), "indexing with [] isn't supported");
+                } else {
+                    return e;
+                }
+            }
+        }
+
+        ExprPtr primary() {
+            const Token &k = peek();
+            if (k.kind == Token::NUMBER) {
+                pos++;
+                return make(Expr::NUMBER, k.line, k.text);
+            }
+            if (accept("(")) {
+                ExprPtr e = expression();
+                expect(")");
+                return e;
+            }
+            if (k.kind != Token::IDENT) throw GlslError(k.line, "expected an expression before '" + k.text + "'");
+            pos++;
+            if (!accept("(")) return make(Expr::NAME, k.line, k.text);
+            ExprPtr e = make(Expr::CALL, k.line, k.text);
+            if (!is(")")) {
+                do {
+                    e->args.push_back(conditional());
+                } while (accept(","));
+            }
+            expect(")");
+            return e;
+        }
+    };
+
+    //what an expression comes to: C++ for each component, a name, a temporary or a literal
+    struct Value {
+        Type type;
+        std::vector<std::string> c;
+    };
+
+    struct Variable {
+        Type type;
+        std::string name;       //in the C++, components get _x, _y.. (_0.._3 for mat2)
+        bool assignable;
+    };
+
+    std::string component(const Variable &v, int i) {
+        if (components(v.type) == 1) return v.name;
+        return v.name + "_" + (v.type == T_MAT2 ? "0123"[i] : "xyzw"[i]);
+    }
+
+    Value value(const Variable &v) {
+        Value r{v.type, {}};
+        for (int i = 0; i < components(v.type); i++) r.c.push_back(component(v, i));
+        return r;
+    }
+
+    //the C++ for a value returned from a function
+    std::string pack(const std::vector<std::string> &c) {
+        if (c.size() == 1) return c[0];
+        std::string s = "{{";
+        for (size_t i = 0; i < c.size(); i++) s += (i ? ", " : "") + c[i];
+        return s + "}}";
+    }
+
+    std::string resultType(Type t) {
+        int n = components(t);
+        if (n == 0) return "void";
+        if (n == 1) return "floatv";
+        return "std::array<floatv, " + std::to_string(n) + ">";
+    }
+
+    //the GLSL built-ins simd.h has a floatv version of, applied component by component
+    const char *componentwise[] = {
+        "sin", "cos", "tan", "asin", "acos", "atan", "exp", "log", "exp2", "log2", "sqrt", "inversesqrt",
+        "abs", "sign", "floor", "ceil", "fract", "radians", "degrees", "mod", "min", "max", "step", "pow",
+        "mix", "clamp", "smoothstep",
+    };
+
+    class Translator {
+    public:
+        //the namespace with the painting's CpuShader, shade()
+        std::string translate(const Shader &shader, const std::string &ns, const std::string &file) {
+            this->shader = &shader;
+            out << "//" << file << "\nnamespace " << ns << " {\n";
+            scopes.assign(1, std::map<std::string, Variable>());
+            const Function *main = NULL;
+            for (const Global &g : shader.globals) {
+                if (g.constant) {
+                    constants = true;
+                    statement(*g.constant);
+                    constants = false;
+                } else {
+                    function(*g.function);
+                    if (g.function->name == "main") main = g.function.get();
+                }
+            }
+            if (!main) throw GlslError(1, "no main()");
+            if (shader.output.empty()) throw GlslError(main->line, "no out vec4 for the color");
+            out << "\n    void shade(floatv u, floatv v, float time, floatv &r, floatv &g, floatv &b) {\n"
+                << "        std::array<floatv, 4> color = f_main(floatv(time), u, v);\n"
+                << "        r = color[0];\n"
+                << "        g = color[1];\n"
+                << "        b = color[2];\n"
+                << "    }\n}\n\n";
+            return out.str();
+        }
+
+    private:
+        std::ostringstream out;
+        int depth = 1;
+        int temps = 0, names = 0;
+        const Shader *shader;
+        std::vector<std::map<std::string, Variable>> scopes;
+        std::map<std::string, const Function*> functions;
+        bool constants = false;             //at the top level, where there's nowhere to put temporaries
+        const Function *current = NULL;
+        bool retire = false;                //the function returns from inside a branch or loop
+        bool retired = false;               //and lanes may have returned by now
+        std::vector<std::string> masks;     //the lanes still running in the branches and loops we're in
+
+        void line(const std::string &s) {
+            out << std::string(depth * 4, ' ') << s << "\n";
+        }
+
+        //expr in a temporary, or as it is for the constants
+        std::string tmp(const std::string &expr) {
+            if (constants) return "(" + expr + ")";
+            std::string name = "t" + std::to_string(++temps);
+            line("const floatv " + name + " = " + expr + ";");
+            return name;
+        }
+
+        //the lanes assignments go to, "" for all of them
+        std::string mask() {
+            std::string m = masks.empty() ? "" : masks.back();
+            if (!retired) return m;
+            return m.empty() ? "live_" : tmp(m + " & live_");
+        }
+
+        bool isMain() const {
+            return current && current->name == "main";
+        }
+
+        Variable lookup(const std::string &name, int line) {
+            for (auto scope = scopes.rbegin(); scope != scopes.rend(); ++scope) {
+                auto v = scope->find(name);
+                if (v != scope->end()) return v->second;
+            }
+            if (name == "time" || name == "fraguv") {
+                if (constants) throw GlslError(line, "a const can't depend on " + name);
+                if (name == "time") return Variable{T_FLOAT, "time_", false};
+                if (shader->fraguv) return Variable{T_VEC2, "fraguv", false};
+            }
+            if (name == shader->output) throw GlslError(line, name + " is only there in main()");
+            for (const std::string &in : shader->inputs) {
+                if (name == in) throw GlslError(line, "the input " + name + " isn't there on the CPU, only fraguv is");
+            }
+            static const char *frame[] = {"dt", "resolution", "frame", "viewMatrix", "projectionMatrix", "viewProjectionMatrix"};
+            for (const char *f : frame) {
+                if (name == f) throw GlslError(line, name + " isn't there on the CPU, time is the only frame global");
+            }
+            throw GlslError(line, name + " isn't declared");
+        }
+
+        void declare(const std::string &name, const Variable &v, int line) {
+            if (scopes.back().count(name)) throw GlslError(line, name + " is already declared");
+            scopes.back()[name] = v;
+        }
+
+        Value convert(const Value &v, Type to, int line) {
+            if (v.type == to || (v.type == T_INT && to == T_FLOAT)) return Value{to, v.c};
+            throw GlslError(line, "a " + typeName(v.type) + " where a " + typeName(to) + " goes");
+        }
+
+        //the paintings mix ints into float math (time * 2): GLSL 4 converts them
+        Value promote(const Value &v) {
+            return v.type == T_INT ? Value{T_FLOAT, v.c} : v;
+        }
+
+        Value zero(Type t) {
+            return Value{t, std::vector<std::string>(components(t), "floatv(0.f)")};
+        }
+
+        //which of the function's statements return from inside a branch or loop
+        static bool returnsInside(const Stmt &s, bool nested) {
+            switch (s.kind) {
+            case Stmt::RETURN: return nested;
+            case Stmt::BLOCK:
+                for (const StmtPtr &c : s.stmts) {
+                    if (returnsInside(*c, nested)) return true;
+                }
+                return false;
+            case Stmt::IF: return returnsInside(*s.body, true) || (s.otherwise && returnsInside(*s.otherwise, true));
+            case Stmt::LOOP: return returnsInside(*s.body, true);
+            default: return false;
+            }
+        }
+
+        void function(const Function &f) {
+            Type type;
+            if (functions.count(f.name) || typeByName(f.name, f.line, type)) {
+                throw GlslError(f.line, "overloading " + f.name + "() isn't supported");
+            }
+            bool main = f.name == "main";
+            if (main && (f.result != T_VOID || !f.params.empty())) throw GlslError(f.line, "main() has to be void main()");
+
+            current = &f;
+            temps = 0;
+            retire = returnsInside(*f.body, false);
+            retired = false;
+            masks.clear();
+            scopes.push_back(std::map<std::string, Variable>());
+            std::string params = "floatv time_, floatv fraguv_x, floatv fraguv_y";
+            for (const Param &p : f.params) {
+                Variable v{p.type, "p" + std::to_string(++names) + "_" + p.name, true};
+                for (int i = 0; i < components(p.type); i++) params += ", floatv " + component(v, i);
+                declare(p.name, v, f.line);
+            }
+            out << "\n";
+            line("inline " + resultType(main ? T_VEC4 : f.result) + " f_" + f.name + "(" + params + ") {");
+            depth++;
+            Variable color{T_VEC4, "o_" + shader->output, true};
+            if (main) {
+                for (int i = 0; i < 4; i++) line("floatv " + component(color, i) + " = floatv(0.f);");
+                scopes.back()[shader->output] = color;
+            }
+            Variable result{f.result, "ret", true};
+            if (retire) {
+                line("floatv live_ = simdTrue();");
+                for (int i = 0; i < components(f.result); i++) line("floatv " + component(result, i) + " = floatv(0.f);");
+            }
+
+            scopes.push_back(std::map<std::string, Variable>());
+            for (const StmtPtr &s : f.body->stmts) statement(*s);
+            scopes.pop_back();
+            scopes.pop_back();
+
+            bool returned = !f.body->stmts.empty() && f.body->stmts.back()->kind == Stmt::RETURN;
+            if (main) {
+                if (!returned) line("return " + pack(value(color).c) + ";");
+            } else if (f.result != T_VOID && retire) {
+                line("return " + pack(value(result).c) + ";");
+            } else if (f.result != T_VOID && !returned) {
+                //GLSL leaves it undefined
+                line("return " + pack(zero(f.result).c) + ";");
+            }
+            depth--;
+            line("}");
+            functions[f.name] = &f;
+            current = NULL;
+        }
+
+        //s, which a branch or loop has already opened a scope for
+        void inside(const Stmt &s) {
+            if (s.kind != Stmt::BLOCK) {
+                statement(s);
+                return;
+            }
+            for (const StmtPtr &c : s.stmts) statement(*c);
+        }
+
+        void branch(const std::string &lanes, const Stmt &s) {
+            line("if (any(" + lanes + ")) {");
+            depth++;
+            masks.push_back(lanes);
+            scopes.push_back(std::map<std::string, Variable>());
+            inside(s);
+            scopes.pop_back();
+            masks.pop_back();
+            depth--;
+            line("}");
+        }
+
+        Value condition(const Expr &e) {
+            Value c = expr(e);
+            if (c.type != T_BOOL) throw GlslError(e.line, "a " + typeName(c.type) + " where a bool condition goes");
+            return c;
+        }
+
+        void statement(const Stmt &s) {
+            switch (s.kind) {
+            case Stmt::BLOCK:
+                line("{");
+                depth++;
+                scopes.push_back(std::map<std::string, Variable>());
+                inside(s);
+                scopes.pop_back();
+                depth--;
+                line("}");
+                break;
+
+            case Stmt::DECLARE:
+                for (size_t i = 0; i < s.names.size(); i++) {
+                    Value v = s.inits[i] ? convert(expr(*s.inits[i]), s.type, s.line) : zero(s.type);
+                    Variable var{s.type, (constants ? "g" : "v" + std::to_string(++names)) + "_" + s.names[i], !s.constant};
+                    for (int j = 0; j < components(s.type); j++) {
+                        line((s.constant ? "const floatv " : "floatv ") + component(var, j) + " = " + v.c[j] + ";");
+                    }
+                    declare(s.names[i], var, s.line);
+                }
+                break;
+
+            case Stmt::EXPRESSION:
+                effect(*s.expr);
+                break;
+
+            case Stmt::IF: {
+                Value c = condition(*s.expr);
+                std::string m = mask();
+                std::string yes = tmp(m.empty() ? c.c[0] : m + " & " + c.c[0]);
+                std::string no;
+                if (s.otherwise) no = tmp(m.empty() ? "maskNot(" + c.c[0] + ")" : "andNot(" + m + ", " + c.c[0] + ")");
+                branch(yes, *s.body);
+                if (s.otherwise) branch(no, *s.otherwise);
+                break;
+            }
+
+            case Stmt::LOOP: {
+                if (!s.expr) throw GlslError(s.line, "a loop without a condition needs break, which isn't supported");
+                line("{");
+                depth++;
+                scopes.push_back(std::map<std::string, Variable>());
+                if (s.init) statement(*s.init);
+                std::string m = mask();
+                std::string lanes = "loop" + std::to_string(++temps);
+                line("floatv " + lanes + " = " + (m.empty() ? "simdTrue()" : m) + ";");
+                line("for (;;) {");
+                depth++;
+                Value c = condition(*s.expr);
+                line(lanes + " = " + lanes + " & " + c.c[0] + ";");
+                if (retire) line(lanes + " = " + lanes + " & live_;");
+                line("if (!any(" + lanes + ")) break;");
+                masks.push_back(lanes);
+                scopes.push_back(std::map<std::string, Variable>());
+                inside(*s.body);
+                scopes.pop_back();
+                if (s.step) effect(*s.step);
+                masks.pop_back();
+                depth--;
+                line("}");
+                scopes.pop_back();
+                depth--;
+                line("}");
+                break;
+            }
+
+            case Stmt::RETURN: {
+                bool main = isMain();
+                Type type = main ? T_VOID : current->result;
+                if (s.expr && type == T_VOID) throw GlslError(s.line, "return with a value from a void function");
+                if (!s.expr && type != T_VOID) throw GlslError(s.line, "return without a value");
+                Value v = s.expr ? convert(expr(*s.expr), type, s.line) : zero(T_VOID);
+                Variable color{T_VEC4, "o_" + shader->output, true}, result{type, "ret", true};
+                std::string m = mask();
+                if (!m.empty()) {
+                    //those lanes are done, the rest go on
+                    for (int i = 0; i < components(type); i++) {
+                        std::string r = component(result, i);
+                        line(r + " = select(" + m + ", " + v.c[i] + ", " + r + ");");
+                    }
+                    if (masks.empty()) v = value(result);
+                    else line("live_ = andNot(live_, " + m + ");");
+                    retired = true;
+                }
+                if (masks.empty()) {
+                    if (main) line("return " + pack(value(color).c) + ";");
+                    else line(type == T_VOID ? "return;" : "return " + pack(v.c) + ";");
+                }
+                break;
+            }
+            }
+        }
+
+        //an expression statement: assignments and ++/-- go to the lanes still running
+        void effect(const Expr &e) {
+            if (e.kind == Expr::ASSIGN) {
+                std::vector<std::string> target;
+                Type type = assignable(*e.args[0], target);
+                Value v = expr(*e.args[1]);
+                if (e.text != "=") v = arithmetic(e.text.substr(0, 1), Value{type, target}, v, e.line);
+                store(target, convert(v, type, e.line));
+            } else if (e.kind == Expr::STEP) {
+                std::vector<std::string> target;
+                Type type = assignable(*e.args[0], target);
+                if (!isScalar(type)) throw GlslError(e.line, e.text + " on a " + typeName(type) + " isn't supported");
+                store(target, Value{type, {tmp(target[0] + (e.text == "++" ? " + " : " - ") + "floatv(1.f)")}});
+            } else {
+                expr(e);
+            }
+        }
+
+        //the components e names, if it's something that can be assigned to
+        Type assignable(const Expr &e, std::vector<std::string> &target) {
+            const Expr &base = e.kind == Expr::FIELD ? *e.args[0] : e;
+            if (base.kind != Expr::NAME) throw GlslError(e.line, "only variables and their components can be assigned to");
+            Variable v = lookup(base.text, e.line);
+            if (!v.assignable) throw GlslError(e.line, base.text + " can't be assigned to");
+            Value all = value(v);
+            if (e.kind != Expr::FIELD) {
+                target = all.c;
+                return v.type;
+            }
+            Value part = swizzle(all, e.text, e.line);
+            for (size_t i = 0; i < part.c.size(); i++) {
+                for (size_t j = 0; j < i; j++) {
+                    if (part.c[i] == part.c[j]) throw GlslError(e.line, "assigning to ." + e.text + " writes a component twice");
+                }
+            }
+            target = part.c;
+            return part.type;
+        }
+
+        void store(const std::vector<std::string> &target, Value v) {
+            //uv = uv.yx would read uv.x after writing it
+            for (size_t i = 0; i < v.c.size(); i++) {
+                for (size_t j = 0; j < target.size(); j++) {
+                    if (j != i && v.c[i] == target[j]) v.c[i] = tmp(v.c[i]);
+                }
+            }
+            std::string m = mask();
+            for (size_t i = 0; i < target.size(); i++) {
+                if (v.c[i] == target[i]) continue;
+                if (m.empty()) line(target[i] + " = " + v.c[i] + ";");
+                else line(target[i] + " = select(" + m + ", " + v.c[i] + ", " + target[i] + ");");
+            }
+        }
+
+        Value swizzle(const Value &v, const std::string &s, int line) {
+            if (!isVec(v.type)) throw GlslError(line, "." + s + " on a " + typeName(v.type) + " isn't supported");
+            static const char *sets[] = {"xyzw", "rgba", "stpq"};
+            const char *set = NULL;
+            for (const char *k : sets) {
+                if (strchr(k, s[0])) set = k;
+            }
+            if (!set || s.size() > 4) throw GlslError(line, "." + s + " isn't a swizzle");
+            Value r{vecType((int)s.size()), {}};
+            for (char c : s) {
+                const char *at = strchr(set, c);
+                if (!at || at - set >= components(v.type)) throw GlslError(line, "a " + typeName(v.type) + " has no ." + s);
+                r.c.push_back(v.c[at - set]);
+            }
+            return r;
+        }
+
+        Value arithmetic(const std::string &op, Value a, Value b, int line) {
+            std::string what = typeName(a.type) + " " + op + " " + typeName(b.type);
+            if (op == "%") throw GlslError(line, "% isn't supported, use mod()");
+            if (a.type == T_BOOL || b.type == T_BOOL || a.type == T_VOID || b.type == T_VOID) throw GlslError(line, what + " isn't supported");
+            if (a.type == T_INT && b.type == T_INT) {
+                if (op == "/") throw GlslError(line, "int / int isn't supported, only float division");
+                return Value{T_INT, {tmp(a.c[0] + " " + op + " " + b.c[0])}};
+            }
+            a = promote(a);
+            b = promote(b);
+            if (op == "*" && (a.type == T_MAT2 || b.type == T_MAT2) && a.type != T_FLOAT && b.type != T_FLOAT) {
+                if (a.type == T_MAT2 && b.type == T_VEC2) {
+                    return Value{T_VEC2, {tmp(a.c[0] + " * " + b.c[0] + " + " + a.c[2] + " * " + b.c[1]),
+                                          tmp(a.c[1] + " * " + b.c[0] + " + " + a.c[3] + " * " + b.c[1])}};
+                }
+                if (a.type == T_VEC2 && b.type == T_MAT2) {
+                    return Value{T_VEC2, {tmp(a.c[0] + " * " + b.c[0] + " + " + a.c[1] + " * " + b.c[1]),
+                                          tmp(a.c[0] + " * " + b.c[2] + " + " + a.c[1] + " * " + b.c[3])}};
+                }
+                if (a.type == T_MAT2 && b.type == T_MAT2) {
+                    Value r{T_MAT2, {}};
+                    for (int col = 0; col < 2; col++) {
+                        for (int row = 0; row < 2; row++) {
+                            r.c.push_back(tmp(a.c[row] + " * " + b.c[col * 2] + " + " + a.c[2 + row] + " * " + b.c[col * 2 + 1]));
+                        }
+                    }
+                    return r;
+                }
+                throw GlslError(line, what + " isn't supported");
+            }
+            if (a.type != T_FLOAT && b.type != T_FLOAT && a.type != b.type) throw GlslError(line, what + " isn't supported");
+            Value r{a.type == T_FLOAT ? b.type : a.type, {}};
+            for (int i = 0; i < components(r.type); i++) {
+                r.c.push_back(tmp(a.c[a.c.size() == 1 ? 0 : i] + " " + op + " " + b.c[b.c.size() == 1 ? 0 : i]));
+            }
+            return r;
+        }
+
+        Value expr(const Expr &e) {
+            switch (e.kind) {
+            case Expr::NUMBER: {
+                std::string n = e.text;
+                bool integer = n.find_first_of(".eEfF") == std::string::npos;
+                if (n.back() == 'f' || n.back() == 'F') n.pop_back();
+                return Value{integer ? T_INT : T_FLOAT, {"floatv(" + n + (integer ? ".f)" : "f)")}};
+            }
+
+            case Expr::NAME:
+                if (e.text == "true") return Value{T_BOOL, {"simdTrue()"}};
+                if (e.text == "false") return Value{T_BOOL, {"floatv(0.f)"}};
+                return value(lookup(e.text, e.line));
+
+            case Expr::UNARY: {
+                Value a = expr(*e.args[0]);
+                if (e.text == "!") {
+                    if (a.type != T_BOOL) throw GlslError(e.line, "! on a " + typeName(a.type));
+                    return Value{T_BOOL, {tmp("maskNot(" + a.c[0] + ")")}};
+                }
+                if (e.text == "~") throw GlslError(e.line, "bitwise operators aren't supported");
+                if (a.type == T_BOOL) throw GlslError(e.line, e.text + " on a bool");
+                if (e.text == "+") return a;
+                for (std::string &c : a.c) c = tmp("-" + c);
+                return a;
+            }
+
+            case Expr::BINARY: {
+                Value a = expr(*e.args[0]), b = expr(*e.args[1]);
+                const std::string &op = e.text;
+                if (op == "+" || op == "-" || op == "*" || op == "/" || op == "%") return arithmetic(op, a, b, e.line);
+                if (op == "&&" || op == "||") {
+                    if (a.type != T_BOOL || b.type != T_BOOL) throw GlslError(e.line, op + " needs bools");
+                    return Value{T_BOOL, {tmp(a.c[0] + (op == "&&" ? " & " : " | ") + b.c[0])}};
+                }
+                if (op == "^^") throw GlslError(e.line, "^^ isn't supported");
+                if (op.size() == 1 && strchr("&|^", op[0])) throw GlslError(e.line, "bitwise operators aren't supported");
+                if (op == "<<" || op == ">>") throw GlslError(e.line, "bitwise operators aren't supported");
+                //the comparisons
+                if (!isScalar(a.type) || !isScalar(b.type)) {
+                    throw GlslError(e.line, typeName(a.type) + " " + op + " " + typeName(b.type) + " isn't supported");
+                }
+                return Value{T_BOOL, {tmp(a.c[0] + " " + op + " " + b.c[0])}};
+            }
+
+            case Expr::SELECT: {
+                Value c = condition(*e.args[0]);
+                Value a = expr(*e.args[1]), b = expr(*e.args[2]);
+                if (a.type != b.type) {
+                    a = promote(a);
+                    b = promote(b);
+                }
+                if (a.type != b.type || a.type == T_VOID) throw GlslError(e.line, "?: with a " + typeName(a.type) + " and a " + typeName(b.type));
+                for (size_t i = 0; i < a.c.size(); i++) a.c[i] = tmp("select(" + c.c[0] + ", " + a.c[i] + ", " + b.c[i] + ")");
+                return a;
+            }
+
+            case Expr::FIELD:
+                return swizzle(expr(*e.args[0]), e.text, e.line);
+
+            case Expr::CALL:
+                return call(e);
+
+            case Expr::ASSIGN:
+            case Expr::STEP:
+                break;
+            }
+            throw GlslError(e.line, "assignments and " + e.text + " only go in statements of their own");
+        }
+
+        Value call(const Expr &e) {
+            const std::string &name = e.text;
+            Type type;
+            if (typeByName(name, e.line, type)) return construct(type, e);
+
+            auto f = functions.find(name);
+            if (f != functions.end()) {
+                if (constants) throw GlslError(e.line, "a const can't call " + name + "()");
+                const Function &fn = *f->second;
+                if (e.args.size() != fn.params.size()) {
+                    throw GlslError(e.line, name + "() takes " + std::to_string(fn.params.size()) + " arguments");
+                }
+                std::string c = "f_" + name + "(time_, fraguv_x, fraguv_y";
+                for (size_t i = 0; i < e.args.size(); i++) {
+                    for (const std::string &a : convert(expr(*e.args[i]), fn.params[i].type, e.line).c) c += ", " + a;
+                }
+                c += ")";
+                int n = components(fn.result);
+                if (n == 0) {
+                    line(c + ";");
+                    return zero(T_VOID);
+                }
+                if (n == 1) return Value{fn.result, {tmp(c)}};
+                std::string r = "t" + std::to_string(++temps);
+                line("const " + resultType(fn.result) + " " + r + " = " + c + ";");
+                Value v{fn.result, {}};
+                for (int i = 0; i < n; i++) v.c.push_back(r + "[" + std::to_string(i) + "]");
+                return v;
+            }
+            if (name == "main") throw GlslError(e.line, "calling main() isn't supported");
+
+            std::vector<Value> args;
+            for (const ExprPtr &a : e.args) {
+                args.push_back(promote(expr(*a)));
+                if (args.back().type == T_BOOL || args.back().type == T_VOID || args.back().type == T_MAT2) {
+                    throw GlslError(e.line, name + "() of a " + typeName(args.back().type) + " isn't supported");
+                }
+            }
+            size_t count = args.size();
+            if (name == "length" && count == 1) return length(args[0]);
+            if (name == "distance" && count == 2) return length(arithmetic("-", args[0], args[1], e.line));
+            if (name == "dot" && count == 2) return dot(args[0], args[1], e.line);
+            if (name == "normalize" && count == 1) {
+                std::string l = length(args[0]).c[0];
+                for (std::string &c : args[0].c) c = tmp(c + " / " + l);
+                return args[0];
+            }
+            if (name == "cross" && count == 2) {
+                if (args[0].type != T_VEC3 || args[1].type != T_VEC3) throw GlslError(e.line, "cross() takes two vec3");
+                const std::vector<std::string> &a = args[0].c, &b = args[1].c;
+                Value r{T_VEC3, {}};
+                for (int i = 0; i < 3; i++) {
+                    int j = (i + 1) % 3, k = (i + 2) % 3;
+                    r.c.push_back(tmp(a[j] + " * " + b[k] + " - " + a[k] + " * " + b[j]));
+                }
+                return r;
+            }
+            for (const char *c : componentwise) {
+                if (name == c) return builtin(e, args);
+            }
+            static const char *gpu[] = {"texture", "texelFetch", "textureLod", "dFdx", "dFdy", "fwidth", "noise1", "noise2", "noise3", "noise4"};
+            for (const char *g : gpu) {
+                if (name == g) throw GlslError(e.line, name + "() isn't supported on the CPU");
+            }
+            throw GlslError(e.line, name + "() isn't supported (or not declared)");
+        }
+
+        //sin, mix and the rest: the same function on each component, scalar arguments go to all of them
+        Value builtin(const Expr &e, const std::vector<Value> &args) {
+            const std::string &name = e.text;
+            size_t want = name == "mix" || name == "clamp" || name == "smoothstep" ? 3
+                        : name == "mod" || name == "min" || name == "max" || name == "step" || name == "pow" ? 2 : 1;
+            if (name == "atan" && args.size() == 2) want = 2;
+            if (args.size() != want) throw GlslError(e.line, name + "() takes " + std::to_string(want) + " arguments");
+            int n = 1;
+            for (const Value &a : args) n = std::max(n, components(a.type));
+            for (const Value &a : args) {
+                if (components(a.type) != 1 && components(a.type) != n) throw GlslError(e.line, name + "() with a vec" + std::to_string(n) + " and a " + typeName(a.type));
+            }
+            Value r{vecType(n), {}};
+            //pow(x, 4.) as multiplies: exact, and what the hand written versions do
+            const Expr &power = *e.args.back();
+            double p = name == "pow" && power.kind == Expr::NUMBER ? atof(power.text.c_str()) : 0.;
+            if (p >= 1. && p <= 8. && p == (int)p) {
+                for (const std::string &x : args[0].c) {
+                    std::string c = x;
+                    for (int i = 1; i < (int)p; i++) c = tmp(c + " * " + x);
+                    r.c.push_back(c);
+                }
+                return r;
+            }
+            for (int i = 0; i < n; i++) {
+                std::string c = name + "(";
+                for (size_t j = 0; j < args.size(); j++) c += (j ? ", " : "") + args[j].c[args[j].c.size() == 1 ? 0 : i];
+                r.c.push_back(tmp(c + ")"));
+            }
+            return r;
+        }
+
+        Value dot(const Value &a, const Value &b, int line) {
+            if (a.type != b.type) throw GlslError(line, "dot() of a " + typeName(a.type) + " and a " + typeName(b.type));
+            std::string s;
+            for (size_t i = 0; i < a.c.size(); i++) s += (i ? " + " : "") + a.c[i] + " * " + b.c[i];
+            return Value{T_FLOAT, {tmp(s)}};
+        }
+
+        Value length(const Value &a) {
+            if (a.c.size() == 1) return Value{T_FLOAT, {tmp("abs(" + a.c[0] + ")")}};
+            return Value{T_FLOAT, {tmp("sqrt(" + dot(a, a, 0).c[0] + ")")}};
+        }
+
+        //vec3(x), vec4(color, 1.), mat2(a, b, c, d)..
+        Value construct(Type type, const Expr &e) {
+            std::vector<Value> args;
+            int total = 0;
+            for (const ExprPtr &a : e.args) {
+                args.push_back(expr(*a));
+                total += components(args.back().type);
+                if (args.back().type == T_VOID) throw GlslError(e.line, typeName(type) + "() of a void");
+            }
+            if (type == T_VOID || args.empty()) throw GlslError(e.line, typeName(type) + "() isn't a value");
+            if (type == T_BOOL || args[0].type == T_BOOL) throw GlslError(e.line, "converting to and from bool isn't supported");
+            if (type == T_INT) {
+                if (args.size() != 1 || args[0].type != T_INT) throw GlslError(e.line, "int() of a " + typeName(args[0].type) + " isn't supported");
+                return args[0];
+            }
+            if (type == T_FLOAT) {
+                if (args.size() != 1 || args[0].type == T_MAT2) throw GlslError(e.line, "float() takes one number");
+                return Value{T_FLOAT, {args[0].c[0]}};
+            }
+            int n = components(type);
+            Value r{type, {}};
+            if (args.size() == 1 && total == 1) {
+                //a vector of that number, or the diagonal of a matrix
+                for (int i = 0; i < n; i++) r.c.push_back(type == T_MAT2 && i % 3 != 0 ? "floatv(0.f)" : args[0].c[0]);
+                return r;
+            }
+            for (const Value &a : args) {
+                if (a.type == T_MAT2 && type != T_MAT2) throw GlslError(e.line, typeName(type) + "() of a mat2 isn't supported");
+                r.c.insert(r.c.end(), a.c.begin(), a.c.end());
+            }
+            if (args.size() == 1 && total > n && type != T_MAT2) r.c.resize(n);
+            if ((int)r.c.size() != n) throw GlslError(e.line, typeName(type) + "() of " + std::to_string(total) + " components");
+            return r;
+        }
+    };
+
+    bool readFile(const char *path, std::string &text) {
+        FILE *in = fopen(path, "rb");
+        if (!in) return false;
+        char buffer[4096];
+        size_t n;
+        while ((n = fread(buffer, 1, sizeof(buffer), in)) > 0) text.append(buffer, n);
+        fclose(in);
+        return true;
+    }
+
+    //shaders/NAME.frag.glsl -> NAME, as cpuShader looks it up
+    std::string paintingName(const std::string &path) {
+        std::string name = path;
+        size_t slash = name.find_last_of("/\\");
+        if (slash != std::string::npos) name.erase(0, slash + 1);
+        size_t ext = name.find(".frag");
+        if (ext != std::string::npos) name.erase(ext);
+        return name;
+    }
+
+    std::string identifier(const std::string &name) {
+        std::string id = "glsl_";
+        for (char c : name) id += isalnum((unsigned char)c) ? c : '_';
+        return id;
+    }
+}
+
+int main(int argc, char **argv) {
+    const char *outfile = NULL;
+    std::vector<const char*> files;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            outfile = argv[++i];
+        } else if (argv[i][0] == '-') {
+            outfile = NULL;
+            break;
+        } else {
+            files.push_back(argv[i]);
+        }
+    }
+    if (!outfile || files.empty()) {
+        printf("usage: %s -o out.cpp shader.frag.glsl...\n", argv[0]);
+        return 1;
+    }
+
+    std::string code = "//generated by tools/glsl2cpp from the painting shaders, change those rather than this\n"
+                       "#include \"cpushaders.h\"\n#include <array>\n\n"
+                       "//the shaders are free to leave a variable unread, GLSL compilers don't mind\n"
+                       "#ifdef __GNUC__\n#pragma GCC diagnostic ignored \"-Wunused-but-set-variable\"\n#endif\n\n"
+                       "namespace {\n";
+    std::vector<std::string> translated;
+    for (const char *file : files) {
+        std::string source;
+        if (!readFile(file, source)) {
+            printf("%s: can't read it\n", file);
+            return 1;
+        }
+        std::string name = paintingName(file);
+        try {
+            Macros macros;
+            std::vector<Token> tokens;
+            tokenize(source, 1, macros, tokens);
+            Shader shader;
+            Parser(tokens).parse(shader);
+            code += Translator().translate(shader, identifier(name), file);
+            translated.push_back(name);
+        } catch (const GlslError &e) {
+            printf("%s:%d: %s, %s gets no CPU version\n", file, e.line, e.what(), name.c_str());
+        }
+    }
+
+    code += "//lets cpushaders.cpp know about all of the above before main starts\n"
+            "struct Registration {\n"
+            "    Registration() {\n";
+    for (const std::string &name : translated) {
+        code += "        registerCpuShader(\"" + name + "\", " + identifier(name) + "::shade);\n";
+    }
+    code += "    }\n} registration;\n}\n";
+
+    FILE *out = fopen(outfile, "wb");
+    if (!out || fwrite(code.data(), 1, code.size(), out) != code.size() || fclose(out) != 0) {
+        printf("%s: can't write it\n", outfile);
+        return 1;
+    }
+    printf("glsl2cpp: %zu of %zu paintings translated to %s\n", translated.size(), files.size(), outfile);
+    return 0;
+}
@@ -0,0 +1,37 @@
+//offline converter for the binary mesh cache (see meshfile.h), so a first launch doesn't pay for
+//the assimp parse either: meshconv [-o out.mesh] file.obj...
+//without -o each entry goes where Geometry looks for it, so run it from the project root
+#include "meshfile.h"
+#include <cstdio>
+#include <cstring>
+
+int main(int argc, char **argv) {
+    const char *outfile = NULL;
+    int converted = 0, failed = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            outfile = argv[++i];
+            continue;
+        }
+        if (argv[i][0] == '-') {
+            printf("usage: %s [-o out.mesh] file.obj...\n", argv[0]);
+            return 1;
+        }
+        MeshData mesh;
+        std::string path = outfile ? std::string(outfile) : meshCachePath(argv[i]);
+        outfile = NULL;
+        if (meshImport(argv[i], mesh) && meshWrite(path, argv[i], mesh)) {
+            printf("%s -> %s (%zu vertices, %zu triangles)\n", argv[i], path.c_str(),
+                   mesh.vertices.size() / MESH_VERTEX_FLOATS, mesh.indices.size() / 3);
+            converted++;
+        } else {
+            printf("%s: conversion failed\n", argv[i]);
+            failed++;
+        }
+    }
+    if (converted + failed == 0) {
+        printf("usage: %s [-o out.mesh] file.obj...\n", argv[0]);
+        return 1;
+    }
+    return failed ? 1 : 0;
+}